@@ -12,6 +12,7 @@ option(GENERATE_MANPAGES "generate manpages" ON)
 option(COMPRESS_MANPAGES "compress manpages" ON)
 option(ENABLE_LIBRARY_DOWNLOAD "allow the application to download songbooks" ON)
 option(ENABLE_SPELLCHECK "allow the application to apply spellchecking within song-editor" ON)
+option(ENABLE_TESTS "build the unit tests and benchmarks" ON)
 
 # {{{ CFLAGS
 if (CMAKE_BUILD_TYPE MATCHES "Release")
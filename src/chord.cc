@@ -18,10 +18,10 @@
 //******************************************************************************
 #include "chord.hh"
 #include "diagram-editor.hh"
+#include "image-cache.hh"
 #include "utils/tango-colors.hh"
 
 #include <QPixmap>
-#include <QPixmapCache>
 #include <QRect>
 #include <QPainter>
 #include <QDebug>
@@ -116,7 +116,8 @@ QPixmap *Chord::toPixmap()
     m_pixmap = new QPixmap(100, 120);
     m_pixmap->fill(Qt::white);
 
-    if (!QPixmapCache::find(toString(), m_pixmap)) {
+    ImageCache *cache = ImageCache::instance();
+    if (!cache->find(ImageCache::ChordDiagrams, toString(), m_pixmap)) {
         QPainter painter;
         painter.begin(m_pixmap);
         painter.setRenderHint(QPainter::Antialiasing, true);
@@ -205,7 +206,7 @@ QPixmap *Chord::toPixmap()
         painter.drawText(fretRect, Qt::AlignCenter, fret());
 
         painter.end();
-        QPixmapCache::insert(toString(), *m_pixmap);
+        cache->insert(ImageCache::ChordDiagrams, toString(), *m_pixmap);
     }
 
     return m_pixmap;
@@ -0,0 +1,128 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "completion-model.hh"
+
+#include <algorithm>
+
+namespace
+{
+// case insensitive order, exact order for strings that only
+// differ by case
+bool lessThan(const QString &s1, const QString &s2)
+{
+    int result = QString::compare(s1, s2, Qt::CaseInsensitive);
+    return (result != 0) ? (result < 0) : (s1 < s2);
+}
+}
+
+CompletionModel::CompletionModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_strings()
+    , m_counts()
+{
+}
+
+CompletionModel::~CompletionModel() {}
+
+int CompletionModel::rowCount(const QModelIndex &index) const
+{
+    return index.isValid() ? 0 : m_strings.size();
+}
+
+QVariant CompletionModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_strings.size())
+        return QVariant();
+
+    if (role == Qt::DisplayRole || role == Qt::EditRole)
+        return m_strings[index.row()];
+
+    return QVariant();
+}
+
+int CompletionModel::position(const QString &string) const
+{
+    return std::lower_bound(m_strings.begin(), m_strings.end(), string,
+                            lessThan) -
+           m_strings.begin();
+}
+
+void CompletionModel::insert(const QString &string)
+{
+    if (!string.isEmpty() && ++m_counts[string] == 1)
+        insertRow(string);
+}
+
+void CompletionModel::insertRow(const QString &string)
+{
+    int row = position(string);
+    beginInsertRows(QModelIndex(), row, row);
+    m_strings.insert(row, string);
+    endInsertRows();
+}
+
+void CompletionModel::insert(const QStringList &strings)
+{
+    QStringList added;
+    foreach (const QString &string, strings) {
+        if (!string.isEmpty() && ++m_counts[string] == 1)
+            added << string;
+    }
+
+    if (added.isEmpty())
+        return;
+
+    if (added.size() == 1) {
+        insertRow(added.first());
+        return;
+    }
+
+    // merge the new strings in a single pass
+    std::sort(added.begin(), added.end(), lessThan);
+    QStringList merged;
+    merged.reserve(m_strings.size() + added.size());
+    std::merge(m_strings.constBegin(), m_strings.constEnd(),
+               added.constBegin(), added.constEnd(),
+               std::back_inserter(merged), lessThan);
+
+    beginResetModel();
+    m_strings.swap(merged);
+    endResetModel();
+}
+
+void CompletionModel::remove(const QString &string)
+{
+    QHash<QString, int>::iterator it = m_counts.find(string);
+    if (it == m_counts.end() || --it.value() > 0)
+        return;
+
+    m_counts.erase(it);
+    int row = position(string);
+    beginRemoveRows(QModelIndex(), row, row);
+    m_strings.removeAt(row);
+    endRemoveRows();
+}
+
+void CompletionModel::clear()
+{
+    beginResetModel();
+    m_strings.clear();
+    m_counts.clear();
+    endResetModel();
+}
@@ -0,0 +1,95 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __COMPLETION_MODEL_HH__
+#define __COMPLETION_MODEL_HH__
+
+#include <QAbstractListModel>
+#include <QModelIndex>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+/*!
+  \file completion-model.hh
+  \class CompletionModel
+  \brief CompletionModel is a sorted list of distinct strings for completers
+
+  A CompletionModel counts the occurrences of the strings it
+  contains: a string is listed as long as it has been inserted more
+  times than it has been removed. Strings are kept sorted without
+  regard to case, so that a QCompleter using this model can be set to
+  QCompleter::CaseInsensitivelySortedModel and use a binary search.
+
+  Inserting or removing a single string only locates its position in
+  the list instead of rebuilding the model.
+*/
+class CompletionModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    CompletionModel(QObject *parent = 0);
+
+    /// Destructor.
+    ~CompletionModel();
+
+    /*!
+    Reimplements QAbstractListModel::rowCount.
+    Returns the number of distinct strings.
+  */
+    virtual int rowCount(const QModelIndex &index = QModelIndex()) const;
+
+    /*!
+    Reimplements QAbstractListModel::data.
+  */
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    /*!
+    Inserts an occurrence of \a string. Empty strings are ignored.
+    \sa remove
+  */
+    void insert(const QString &string);
+
+    /*!
+    Inserts an occurrence of each string from \a strings.
+    \sa insert
+  */
+    void insert(const QStringList &strings);
+
+    /*!
+    Removes an occurrence of \a string.
+    \sa insert
+  */
+    void remove(const QString &string);
+
+    /*!
+    Removes all strings.
+  */
+    void clear();
+
+private:
+    int position(const QString &string) const;
+    void insertRow(const QString &string);
+
+    QStringList m_strings;
+    QHash<QString, int> m_counts;
+};
+
+#endif // __COMPLETION_MODEL_HH__
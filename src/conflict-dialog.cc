@@ -19,6 +19,8 @@
 
 #include "conflict-dialog.hh"
 #include "song.hh"
+#include "thumbnail-cache.hh"
+#include "image-cache.hh"
 
 #include "diff_match_patch/diff_match_patch.h"
 
@@ -34,7 +36,6 @@
 #include <QTableWidget>
 #include <QHeaderView>
 #include <QPixmap>
-#include <QPixmapCache>
 #include <QDesktopServices>
 #include <QCryptographicHash>
 #include <QWizard>
@@ -154,22 +155,25 @@ void ConflictDialog::updateItemDetails(QTableWidgetItem *item)
     QString path = item->data(Qt::ToolTipRole).toString();
     QFileInfo fi(path);
 
-    Song song = Song::fromFile(path);
+    Song song = Song::headerFromFile(path);
     m_titleLabel->setText(song.title);
     m_artistLabel->setText(song.artist);
     m_albumLabel->setText(song.album);
 
     QString cover =
         QString("%1/%2.jpg").arg(fi.absolutePath()).arg(song.coverName);
-    if (QFile(cover).exists()) {
-        m_pixmap->load(cover);
-        *m_pixmap = m_pixmap->scaled(42, 42);
-    } else if (!QPixmapCache::find("cover-missing-full", m_pixmap)) {
+    QImage thumbnail =
+        ThumbnailCache::instance()->thumbnail(cover, QSize(42, 42));
+    if (!thumbnail.isNull()) {
+        *m_pixmap = QPixmap::fromImage(thumbnail);
+    } else if (!ImageCache::instance()->find(ImageCache::Covers,
+                                             "cover-missing-42", m_pixmap)) {
         *m_pixmap = QIcon::fromTheme(
                         "image-missing",
                         QIcon(":/icons/tango/32x32/status/image-missing.png"))
                         .pixmap(42, 42);
-        QPixmapCache::insert("cover-missing-full", *m_pixmap);
+        ImageCache::instance()->insert(ImageCache::Covers, "cover-missing-42",
+                                       *m_pixmap);
     }
 
     m_coverLabel->setPixmap(*m_pixmap);
@@ -262,7 +266,7 @@ void ConflictDialog::showDiff()
         if (source.open(QIODevice::ReadOnly) &&
             target.open(QIODevice::ReadOnly)) {
             // retrieve source song infos
-            Song song = Song::fromFile(it.key());
+            Song song = Song::headerFromFile(it.key());
             QFileInfo fi(it.key());
             QString cover =
                 QString("%1/%2.jpg").arg(fi.absolutePath()).arg(song.coverName);
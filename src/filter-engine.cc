@@ -0,0 +1,187 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "filter-engine.hh"
+
+#include "library-store.hh"
+
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+namespace
+{
+// rows evaluated by a single task
+const int ChunkSize = 4096;
+
+// the cancellation flag is polled every CancelInterval rows
+const int CancelInterval = 256;
+
+struct Snapshot
+{
+    LibraryStore songs;
+    QBitArray selection;
+    FilterQuery query;
+    QBitArray candidates;
+    QSharedPointer<QAtomicInt> canceled;
+};
+
+struct Chunk
+{
+    QSharedPointer<const Snapshot> snapshot;
+    int first;
+    int size;
+    QBitArray accepted;
+};
+
+Chunk evaluateChunk(const Chunk &chunk)
+{
+    Chunk result = chunk;
+    const Snapshot &snapshot = *chunk.snapshot;
+    const FilterQuery &query = snapshot.query;
+    bool selection = query.usesSelection();
+
+    result.accepted.resize(chunk.size);
+    for (int i = 0; i < chunk.size; ++i) {
+        if (i % CancelInterval == 0 && snapshot.canceled->load())
+            return result;
+
+        int row = chunk.first + i;
+        if (!snapshot.candidates.isNull() && !snapshot.candidates.testBit(row))
+            continue;
+        bool checked = selection && snapshot.selection.testBit(row);
+        if (query.accepts(snapshot.songs, row, checked))
+            result.accepted.setBit(i);
+    }
+    return result;
+}
+
+void mergeChunk(FilterEngine::Result &result, const Chunk &chunk)
+{
+    QBitArray &accepted = result.accepted;
+    if (accepted.isNull())
+        accepted.resize(chunk.snapshot->songs.size());
+
+    for (int i = 0; i < chunk.accepted.size(); ++i) {
+        if (chunk.accepted.testBit(i))
+            accepted.setBit(chunk.first + i);
+    }
+}
+
+/*!
+  Scores the songs of \a snapshot by similarity with the fuzzy words
+  of its query, then evaluates the \a chunks with these scores.
+*/
+FilterEngine::Result evaluateFuzzy(const QSharedPointer<Snapshot> &snapshot,
+                                   const QList<Chunk> &chunks)
+{
+    FilterEngine::Result result;
+    const LibraryStore &songs = snapshot->songs;
+    QHash<int, qreal> found =
+        songs.trigramIndex().search(snapshot->query.fuzzyWords());
+
+    result.scores.fill(0, songs.size());
+    QHash<int, qreal>::const_iterator it = found.constBegin();
+    for (; it != found.constEnd(); ++it)
+        result.scores[it.key()] = it.value();
+
+    // the chunks see the scores through the shared snapshot
+    snapshot->query.setFuzzyScores(result.scores);
+    if (snapshot->canceled->load())
+        return result;
+
+    result.accepted = QtConcurrent::blockingMappedReduced(
+                          chunks, evaluateChunk, mergeChunk,
+                          QtConcurrent::UnorderedReduce)
+                          .accepted;
+    return result;
+}
+}
+
+FilterEngine::FilterEngine(QObject *parent)
+    : QObject(parent)
+    , m_watcher(new QFutureWatcher<Result>(this))
+    , m_canceled()
+{
+    connect(m_watcher, SIGNAL(finished()), SLOT(finished()));
+}
+
+FilterEngine::~FilterEngine() { cancel(); }
+
+void FilterEngine::evaluate(const LibraryStore &songs,
+                            const QBitArray &selection,
+                            const FilterQuery &query,
+                            const QBitArray &candidates)
+{
+    cancel();
+
+    QSharedPointer<Snapshot> snapshot(new Snapshot);
+    snapshot->songs = songs;
+    snapshot->selection = selection;
+    snapshot->query = query;
+    snapshot->candidates = candidates;
+    snapshot->canceled = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+    m_canceled = snapshot->canceled;
+
+    QList<Chunk> chunks;
+    Chunk chunk;
+    chunk.snapshot = snapshot;
+    for (chunk.first = 0; chunk.first < songs.size();
+         chunk.first += ChunkSize) {
+        chunk.size = qMin(ChunkSize, songs.size() - chunk.first);
+        chunks << chunk;
+    }
+
+    if (chunks.isEmpty()) {
+        m_canceled.clear();
+        emit(evaluated(QBitArray(), QVector<qreal>()));
+        return;
+    }
+
+    // the fuzzy scores are computed in the background before the chunks
+    if (query.isFuzzy()) {
+        m_watcher->setFuture(QtConcurrent::run(evaluateFuzzy, snapshot,
+                                               chunks));
+        return;
+    }
+
+    // chunks are merged as soon as they are evaluated, in any order
+    m_watcher->setFuture(QtConcurrent::mappedReduced(
+        chunks, evaluateChunk, mergeChunk, QtConcurrent::UnorderedReduce));
+}
+
+bool FilterEngine::isRunning() const { return !m_canceled.isNull(); }
+
+void FilterEngine::cancel()
+{
+    if (m_canceled) {
+        m_canceled->store(1);
+        m_canceled.clear();
+        m_watcher->cancel();
+    }
+}
+
+void FilterEngine::finished()
+{
+    // an evaluation superseded by a newer one has been canceled
+    if (!m_canceled || m_canceled->load())
+        return;
+
+    m_canceled.clear();
+    Result result = m_watcher->result();
+    emit(evaluated(result.accepted, result.scores));
+}
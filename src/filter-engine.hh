@@ -0,0 +1,113 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __FILTER_ENGINE_HH__
+#define __FILTER_ENGINE_HH__
+
+#include <QObject>
+#include <QBitArray>
+#include <QVector>
+#include <QAtomicInt>
+#include <QSharedPointer>
+
+#include "filter-query.hh"
+
+class LibraryStore;
+template <typename T> class QFutureWatcher;
+
+/*!
+  \file filter-engine.hh
+  \class FilterEngine
+  \brief FilterEngine evaluates a filter over the whole library in the
+  background
+
+  A compiled FilterQuery is evaluated over all the songs, which are
+  split into chunks that are evaluated in parallel on the global
+  thread pool. The result is a bitmap of the accepted rows, so
+  that SongSortFilterProxyModel::filterAcceptsRow only has to test a
+  bit.
+
+  In fuzzy mode, the songs are first scored by similarity with the
+  keywords through the TrigramIndex of the store, on the thread pool
+  as well; the scores are indexed by row, like the store.
+
+  Evaluations work on a copy of the LibraryStore, which is cheap since
+  its columns are implicitly shared. Starting a new evaluation cancels
+  the previous one, whose result is discarded.
+
+  \sa SongSortFilterProxyModel
+*/
+class FilterEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+      The result of an evaluation.
+    */
+    struct Result {
+        QBitArray accepted;    /*!< the accepted rows.*/
+        QVector<qreal> scores; /*!< the similarity of each row in fuzzy
+                                  mode, 0 if it does not match.*/
+    };
+
+    /// Constructor.
+    FilterEngine(QObject *parent = 0);
+
+    /// Destructor.
+    ~FilterEngine();
+
+    /*!
+    Evaluates \a query over \a songs. If the query uses the selection,
+    the checked state of the songs is given by \a selection. When
+    \a candidates is not null, only its rows are evaluated and the
+    others are rejected.
+    \sa evaluated
+  */
+    void evaluate(const LibraryStore &songs, const QBitArray &selection,
+                  const FilterQuery &query,
+                  const QBitArray &candidates = QBitArray());
+
+    /*!
+    Returns true if an evaluation is in progress.
+  */
+    bool isRunning() const;
+
+public slots:
+    /*!
+    Cancels the evaluation in progress, if any.
+  */
+    void cancel();
+
+signals:
+    /*!
+    This signal is emitted with the bitmap of the \a accepted rows when
+    the last evaluation is done. In fuzzy mode, \a scores holds the
+    similarity of each row; it is empty otherwise.
+  */
+    void evaluated(const QBitArray &accepted, const QVector<qreal> &scores);
+
+private slots:
+    void finished();
+
+private:
+    QFutureWatcher<Result> *m_watcher;
+    QSharedPointer<QAtomicInt> m_canceled;
+};
+
+#endif // __FILTER_ENGINE_HH__
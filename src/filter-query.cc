@@ -0,0 +1,634 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "filter-query.hh"
+
+#include "library-store.hh"
+#include "text-folding.hh"
+
+#include <QLocale>
+
+namespace
+{
+// each word is the beginning of a refined word
+bool prefixedBy(const QStringList &words, const QStringList &refinedWords)
+{
+    foreach (const QString &word, words) {
+        bool prefixed = false;
+        foreach (const QString &refinedWord, refinedWords) {
+            if (refinedWord.startsWith(word)) {
+                prefixed = true;
+                break;
+            }
+        }
+        if (!prefixed)
+            return false;
+    }
+    return true;
+}
+
+// the language of a two letter code, or -1
+int languageCode(const QString &code)
+{
+    if (code.size() != 2)
+        return -1;
+    QLocale::Language language = QLocale(code).language();
+    return (language == QLocale::C) ? -1 : int(language);
+}
+
+// the language of a :fr or lang:fr term, or -1; :se... is being
+// typed as :selection
+int languageTerm(const QString &word)
+{
+    if (word.startsWith(QLatin1String("lang:")))
+        return languageCode(word.mid(5));
+    if (word.startsWith(QLatin1Char(':')) &&
+        !QString("selection").startsWith(word.mid(1)))
+        return languageCode(word.mid(1));
+    return -1;
+}
+}
+
+/*!
+  \class FilterQuery::Parser
+  Recursive descent parser of filter strings:
+
+  \code
+  query   := or*
+  or      := and ("OR" and)*
+  and     := unary*
+  unary   := "!" unary | primary
+  primary := "(" or ")" | term
+  \endcode
+*/
+class FilterQuery::Parser
+{
+public:
+    Parser(FilterQuery *query, const QString &filter, int position);
+
+    int parse();
+
+private:
+    enum Token {
+        End,
+        Word,
+        Phrase,
+        Open,
+        Close,
+        OrToken,
+        NotToken,
+        LyricsToken
+    };
+
+    void next();
+    int parseOr();
+    int parseAnd();
+    int parseUnary();
+    int parsePrimary();
+    int parseWord(const QString &word);
+
+    FilterQuery *m_query;
+    const QString m_filter;
+    int m_position;
+    Token m_token;
+    QString m_text;
+};
+
+FilterQuery::Parser::Parser(FilterQuery *query, const QString &filter,
+                            int position)
+    : m_query(query)
+    , m_filter(filter)
+    , m_position(position)
+    , m_token(End)
+    , m_text()
+{
+}
+
+void FilterQuery::Parser::next()
+{
+    const int size = m_filter.size();
+    while (m_position < size && m_filter[m_position].isSpace())
+        ++m_position;
+
+    m_text.clear();
+    if (m_position == size) {
+        m_token = End;
+        return;
+    }
+
+    QChar c = m_filter[m_position];
+    if (c == QLatin1Char('(') || c == QLatin1Char(')') ||
+        c == QLatin1Char('|') || c == QLatin1Char('!')) {
+        ++m_position;
+        m_token = (c == QLatin1Char('('))
+                      ? Open
+                      : (c == QLatin1Char(')'))
+                            ? Close
+                            : (c == QLatin1Char('|')) ? OrToken : NotToken;
+        return;
+    }
+
+    // a quoted text, or the quoted value of a field
+    bool quoted = false;
+    m_token = Word;
+    while (m_position < size) {
+        c = m_filter[m_position];
+        if (c == QLatin1Char('"') &&
+            (m_text.isEmpty() || m_text.endsWith(QLatin1Char(':')))) {
+            if (m_text.isEmpty())
+                m_token = Phrase;
+            int end = m_filter.indexOf(QLatin1Char('"'), m_position + 1);
+            if (end == -1)
+                end = size;
+            m_text += m_filter.midRef(m_position + 1, end - m_position - 1);
+            m_position = qMin(end + 1, size);
+            quoted = true;
+            break;
+        }
+        if (c.isSpace() || c == QLatin1Char('(') || c == QLatin1Char(')') ||
+            c == QLatin1Char('|') || c == QLatin1Char('"'))
+            break;
+        m_text += c;
+        ++m_position;
+    }
+
+    if (quoted)
+        return;
+
+    if (m_text == QLatin1String("OR")) {
+        m_token = OrToken;
+    } else if (m_text.startsWith(QLatin1String("lyrics:"))) {
+        // everything after lyrics: is searched in the lyrics
+        m_token = LyricsToken;
+        m_text = m_filter.mid(m_position - m_text.size() + 7).trimmed();
+        m_position = size;
+    }
+}
+
+int FilterQuery::Parser::parse()
+{
+    next();
+
+    Node node(And);
+    for (;;) {
+        int child = parseOr();
+        if (m_query->m_nodes[child].type != True)
+            node.children << child;
+        if (m_token == End)
+            break;
+        next(); // unbalanced )
+    }
+
+    if (node.children.isEmpty())
+        return m_query->add(Node(True));
+    if (node.children.size() == 1)
+        return node.children.first();
+    return m_query->add(node);
+}
+
+int FilterQuery::Parser::parseOr()
+{
+    int first = parseAnd();
+    if (m_token != OrToken)
+        return first;
+
+    Node node(Or);
+    node.children << first;
+    while (m_token == OrToken) {
+        next();
+        node.children << parseAnd();
+    }
+
+    // an empty alternative accepts every song
+    for (int i = 0; i < node.children.size(); ++i) {
+        if (m_query->m_nodes[node.children[i]].type == True)
+            return node.children[i];
+    }
+    return m_query->add(node);
+}
+
+int FilterQuery::Parser::parseAnd()
+{
+    Node node(And);
+    int languages = -1;
+    while (m_token != End && m_token != Close && m_token != OrToken) {
+        // languages given as :fr :en or lang:fr lang:en are
+        // alternatives
+        if (m_token == Word) {
+            int language = languageTerm(m_text);
+            if (language != -1) {
+                next();
+                if (languages == -1) {
+                    Node languageNode(Language);
+                    languageNode.values << language;
+                    languages = m_query->add(languageNode);
+                    node.children << languages;
+                } else {
+                    m_query->m_nodes[languages].values << language;
+                }
+                continue;
+            }
+        }
+
+        int child = parseUnary();
+        if (m_query->m_nodes[child].type != True)
+            node.children << child;
+    }
+
+    if (node.children.isEmpty())
+        return m_query->add(Node(True));
+    if (node.children.size() == 1)
+        return node.children.first();
+    return m_query->add(node);
+}
+
+int FilterQuery::Parser::parseUnary()
+{
+    if (m_token != NotToken)
+        return parsePrimary();
+
+    next();
+    if (m_token == End || m_token == Close || m_token == OrToken)
+        return m_query->add(Node(True));
+
+    int child = parseUnary();
+    if (m_query->m_nodes[child].type == True)
+        return child;
+
+    Node node(Not);
+    node.children << child;
+    return m_query->add(node);
+}
+
+int FilterQuery::Parser::parsePrimary()
+{
+    Token token = m_token;
+    QString text = m_text;
+    next();
+
+    switch (token) {
+    case Open: {
+        int child = parseOr();
+        if (m_token == Close)
+            next();
+        return child;
+    }
+    case Phrase: {
+        Node node(Keyword);
+        node.text = fold(text);
+        if (node.text.isEmpty())
+            break;
+        return m_query->add(node);
+    }
+    case LyricsToken: {
+        if (text.isEmpty())
+            break;
+        Node node(Lyrics);
+        node.text = text;
+        m_query->m_lyrics = text;
+        return m_query->add(node);
+    }
+    case Word:
+        return parseWord(text);
+    default:
+        break;
+    }
+    return m_query->add(Node(True));
+}
+
+int FilterQuery::Parser::parseWord(const QString &word)
+{
+    int colon = word.indexOf(QLatin1Char(':'));
+    QString field = word.left(colon);
+    QString value = word.mid(colon + 1);
+
+    Node node(True);
+    if (colon == -1) {
+        node.type = Keyword;
+        node.text = fold(word);
+    } else if (field.isEmpty()) {
+        // :se... is being typed as :selection
+        if (value == QLatin1String("selection")) {
+            node.type = Selected;
+            m_query->m_usesSelection = true;
+        } else if (!QString("selection").startsWith(value)) {
+            int language = languageCode(value);
+            if (language != -1) {
+                node.type = Language;
+                node.values << language;
+            }
+        }
+    } else if (field == QLatin1String("title") ||
+               field == QLatin1String("artist") ||
+               field == QLatin1String("album")) {
+        node.type = Keyword;
+        node.field = (field == QLatin1String("title"))
+                         ? TitleField
+                         : (field == QLatin1String("artist")) ? ArtistField
+                                                              : AlbumField;
+        node.text = fold(value);
+    } else if (field == QLatin1String("lang")) {
+        int language = languageCode(value);
+        if (language != -1) {
+            node.type = Language;
+            node.values << language;
+        }
+    } else if (field == QLatin1String("capo")) {
+        QChar comparison = value.isEmpty() ? QChar() : value.at(0);
+        bool ok = false;
+        int capo = value.mid(comparison.isDigit() ? 0 : 1).toInt(&ok);
+        if (ok) {
+            node.type = Capo;
+            if (comparison == QLatin1Char('>'))
+                node.values << capo + 1 << 127;
+            else if (comparison == QLatin1Char('<'))
+                node.values << -128 << capo - 1;
+            else if (comparison.isDigit())
+                node.values << capo << capo;
+            else
+                node.type = True;
+        }
+    } else if (word == QLatin1String("has:lilypond")) {
+        node.type = Lilypond;
+    } else if (word == QLatin1String("has:cover")) {
+        node.type = Cover;
+    } else if (field != QLatin1String("has")) {
+        // not a field: the colon is part of the keyword
+        node.type = Keyword;
+        node.text = fold(word);
+    }
+
+    if (node.type == Keyword && node.text.isEmpty())
+        node.type = True;
+    return m_query->add(node);
+}
+
+FilterQuery::Node::Node(Type type)
+    : type(type)
+    , field(AnyField)
+    , text()
+    , values()
+    , children()
+{
+}
+
+bool FilterQuery::Node::operator==(const Node &other) const
+{
+    return type == other.type && field == other.field &&
+           text == other.text && values == other.values &&
+           children.size() == other.children.size();
+}
+
+FilterQuery::FilterQuery()
+    : m_nodes()
+    , m_root(0)
+    , m_usesSelection(false)
+    , m_lyrics()
+    , m_lyricsMatches()
+    , m_fuzzyWords()
+    , m_fuzzyScores()
+{
+    add(Node(True));
+}
+
+FilterQuery::FilterQuery(const QString &filter)
+    : m_nodes()
+    , m_root(0)
+    , m_usesSelection(false)
+    , m_lyrics()
+    , m_lyricsMatches()
+    , m_fuzzyWords()
+    , m_fuzzyScores()
+{
+    bool fuzzy = filter.startsWith(QLatin1Char('~'));
+    Parser parser(this, filter, fuzzy ? 1 : 0);
+    m_root = parser.parse();
+    if (fuzzy)
+        matchApproximately();
+}
+
+FilterQuery::~FilterQuery() {}
+
+int FilterQuery::add(const Node &node)
+{
+    m_nodes << node;
+    return m_nodes.size() - 1;
+}
+
+void FilterQuery::matchApproximately()
+{
+    // the plain keywords that all songs must match are replaced by
+    // a single approximate match
+    QVector<int> conjuncts;
+    if (m_nodes[m_root].type == And)
+        conjuncts = m_nodes[m_root].children;
+    else
+        conjuncts << m_root;
+
+    Node node(And);
+    QStringList keywords;
+    foreach (int child, conjuncts) {
+        if (m_nodes[child].type == Keyword &&
+            m_nodes[child].field == AnyField)
+            keywords << m_nodes[child].text;
+        else
+            node.children << child;
+    }
+
+    m_fuzzyWords = foldedWords(keywords.join(" "));
+    if (m_fuzzyWords.isEmpty())
+        return;
+
+    Node fuzzyNode(Fuzzy);
+    fuzzyNode.text = m_fuzzyWords.join(" ");
+    node.children << add(fuzzyNode);
+    m_root = (node.children.size() == 1) ? node.children.first() : add(node);
+}
+
+bool FilterQuery::isEmpty() const { return m_nodes[m_root].type == True; }
+
+bool FilterQuery::usesSelection() const { return m_usesSelection; }
+
+const QString &FilterQuery::lyrics() const { return m_lyrics; }
+
+void FilterQuery::setLyricsMatches(const QSet<QString> &paths)
+{
+    m_lyricsMatches = paths;
+}
+
+bool FilterQuery::isFuzzy() const { return !m_fuzzyWords.isEmpty(); }
+
+const QStringList &FilterQuery::fuzzyWords() const { return m_fuzzyWords; }
+
+void FilterQuery::setFuzzyScores(const QVector<qreal> &scores)
+{
+    m_fuzzyScores = scores;
+}
+
+const QVector<qreal> &FilterQuery::fuzzyScores() const
+{
+    return m_fuzzyScores;
+}
+
+bool FilterQuery::accepts(const LibraryStore &songs, int row,
+                          bool checked) const
+{
+    return evaluate(m_root, songs, row, checked);
+}
+
+bool FilterQuery::evaluate(int id, const LibraryStore &songs, int row,
+                           bool checked) const
+{
+    const Node &node = m_nodes[id];
+    switch (node.type) {
+    case True:
+        return true;
+    case And:
+        for (int i = 0; i < node.children.size(); ++i) {
+            if (!evaluate(node.children[i], songs, row, checked))
+                return false;
+        }
+        return true;
+    case Or:
+        for (int i = 0; i < node.children.size(); ++i) {
+            if (evaluate(node.children[i], songs, row, checked))
+                return true;
+        }
+        return false;
+    case Not:
+        return !evaluate(node.children[0], songs, row, checked);
+    case Keyword: {
+        // the search key holds the title, artist and album by lines
+        const QString &key = songs.searchKey(row);
+        if (node.field == AnyField)
+            return key.contains(node.text);
+
+        int begin = 0;
+        for (int field = TitleField; field < node.field; ++field)
+            begin = key.indexOf(QLatin1Char('\n'), begin) + 1;
+        int end = key.indexOf(QLatin1Char('\n'), begin);
+        if (end == -1)
+            end = key.size();
+        return key.midRef(begin, end - begin).contains(node.text);
+    }
+    case Language:
+        return node.values.contains(int(songs.language(row)));
+    case Capo: {
+        int capo = songs.capo(row);
+        return capo >= node.values[0] && capo <= node.values[1];
+    }
+    case Lilypond:
+        return songs.isLilypond(row);
+    case Cover:
+        return !songs.coverName(row).isEmpty();
+    case Selected:
+        return checked;
+    case Lyrics:
+        return m_lyricsMatches.contains(songs.path(row));
+    case Fuzzy:
+        return m_fuzzyScores.value(row) > 0;
+    }
+    return true;
+}
+
+bool FilterQuery::refines(const FilterQuery &query) const
+{
+    return implies(m_root, query, query.m_root);
+}
+
+bool FilterQuery::equals(int id, const FilterQuery &query, int other) const
+{
+    const Node &node = m_nodes[id];
+    if (!(node == query.m_nodes[other]))
+        return false;
+
+    const QVector<int> &children = query.m_nodes[other].children;
+    for (int i = 0; i < node.children.size(); ++i) {
+        if (!equals(node.children[i], query, children[i]))
+            return false;
+    }
+    return true;
+}
+
+bool FilterQuery::implies(int id, const FilterQuery &query, int other) const
+{
+    const Node &node = m_nodes[id];
+    const Node &otherNode = query.m_nodes[other];
+
+    if (otherNode.type == True || equals(id, query, other))
+        return true;
+
+    // conjunctions and disjunctions
+    if (otherNode.type == And) {
+        foreach (int child, otherNode.children) {
+            if (!implies(id, query, child))
+                return false;
+        }
+        return true;
+    }
+    if (node.type == Or) {
+        foreach (int child, node.children) {
+            if (!implies(child, query, other))
+                return false;
+        }
+        return true;
+    }
+    if (otherNode.type == Or) {
+        foreach (int child, otherNode.children) {
+            if (implies(id, query, child))
+                return true;
+        }
+    }
+    if (node.type == And) {
+        foreach (int child, node.children) {
+            if (implies(child, query, other))
+                return true;
+        }
+        return false;
+    }
+
+    if (node.type != otherNode.type)
+        return false;
+
+    switch (node.type) {
+    case Not:
+        // a negation is refined by the negation of a wider term
+        return query.implies(otherNode.children[0], *this, node.children[0]);
+    case Keyword:
+        // a longer text matches less songs
+        return (otherNode.field == AnyField ||
+                otherNode.field == node.field) &&
+               node.text.contains(otherNode.text);
+    case Language:
+        foreach (int language, node.values) {
+            if (!otherNode.values.contains(language))
+                return false;
+        }
+        return true;
+    case Capo:
+        return node.values[0] >= otherNode.values[0] &&
+               node.values[1] <= otherNode.values[1];
+    case Lyrics: {
+        QStringList words = foldedWords(otherNode.text);
+        return !words.isEmpty() &&
+               prefixedBy(words, foldedWords(node.text));
+    }
+    default:
+        return false;
+    }
+}
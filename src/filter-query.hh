@@ -0,0 +1,184 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __FILTER_QUERY_HH__
+#define __FILTER_QUERY_HH__
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QSet>
+
+class LibraryStore;
+
+/*!
+  \file filter-query.hh
+  \class FilterQuery
+  \brief FilterQuery is the compiled form of a library filter string
+
+  A filter string is parsed once into a tree of predicates, which is
+  then evaluated for each song without allocating memory. Terms
+  separated by spaces must all match; the syntax is:
+
+  \li \e word or \e "some words": the title, artist or album contains
+  the text, regardless of case and diacritics;
+  \li \e title:, \e artist:, \e album: followed by a word or a quoted
+  text: the given field contains the text;
+  \li \e lang:fr or \e :fr: the song is written in french; several
+  language terms of a same group (:fr lang:en) match any of their
+  languages;
+  \li \e capo:2, \e capo:>0, \e capo:<3: compares the capo of the song;
+  \li \e has:lilypond, \e has:cover: the song has lilypond music
+  sheets, or a cover;
+  \li \e :selection: the song is checked in the songbook;
+  \li \e !term: the term does not match;
+  \li \e term OR \e term (or \e |): either term matches;
+  \li \e ( and \e ): groups terms;
+  \li \e lyrics: followed by the rest of the string: the lyrics contain
+  the words, see LyricsIndex;
+  \li a leading \e ~ matches the plain words approximately, see
+  TrigramIndex.
+
+  The songs matching the lyrics or the approximate words are given by
+  setLyricsMatches() and setFuzzyScores(), since they are found
+  through indexes.
+
+  \sa SongSortFilterProxyModel, FilterEngine
+*/
+class FilterQuery
+{
+public:
+    /// Constructor. An empty query accepts every song.
+    FilterQuery();
+
+    /// Compiles \a filter.
+    explicit FilterQuery(const QString &filter);
+
+    /// Destructor.
+    ~FilterQuery();
+
+    /*!
+    Returns true if the query accepts every song.
+  */
+    bool isEmpty() const;
+
+    /*!
+    Returns true if the song at position \a row of \a songs matches
+    the query; \a checked is its checked state in the songbook.
+    \sa usesSelection
+  */
+    bool accepts(const LibraryStore &songs, int row, bool checked) const;
+
+    /*!
+    Returns true if the query depends on the checked state of the
+    songs, which does not need to be given otherwise.
+  */
+    bool usesSelection() const;
+
+    /*!
+    Returns true if every song accepted by this query is accepted by
+    \a query, for instance when a keyword has been typed further or a
+    negative term has been added.
+  */
+    bool refines(const FilterQuery &query) const;
+
+    /*!
+    Returns the words searched in the lyrics, after "lyrics:".
+    \sa setLyricsMatches
+  */
+    const QString &lyrics() const;
+
+    /*!
+    Sets the paths of the songs whose lyrics match.
+    \sa lyrics
+  */
+    void setLyricsMatches(const QSet<QString> &paths);
+
+    /*!
+    Returns true if the plain words of the query are matched
+    approximately.
+    \sa fuzzyWords, setFuzzyScores
+  */
+    bool isFuzzy() const;
+
+    /*!
+    Returns the folded plain words that are matched approximately.
+  */
+    const QStringList &fuzzyWords() const;
+
+    /*!
+    Sets the similarity of the songs with fuzzyWords(), indexed by row
+    like the LibraryStore; songs whose similarity is 0 do not match.
+    \sa FilterEngine
+  */
+    void setFuzzyScores(const QVector<qreal> &scores);
+
+    /*!
+    Returns the similarities given to setFuzzyScores().
+  */
+    const QVector<qreal> &fuzzyScores() const;
+
+private:
+    enum Type {
+        True,
+        And,
+        Or,
+        Not,
+        Keyword,
+        Language,
+        Capo,
+        Lilypond,
+        Cover,
+        Selected,
+        Lyrics,
+        Fuzzy
+    };
+
+    enum Field { AnyField, TitleField, ArtistField, AlbumField };
+
+    struct Node
+    {
+        Node(Type type = True);
+        bool operator==(const Node &other) const;
+
+        Type type;
+        Field field;
+        QString text;
+        QVector<int> values;
+        QVector<int> children;
+    };
+
+    class Parser;
+
+    int add(const Node &node);
+    bool evaluate(int node, const LibraryStore &songs, int row,
+                  bool checked) const;
+    bool equals(int node, const FilterQuery &query, int other) const;
+    bool implies(int node, const FilterQuery &query, int other) const;
+    void matchApproximately();
+
+    QVector<Node> m_nodes;
+    int m_root;
+    bool m_usesSelection;
+    QString m_lyrics;
+    QSet<QString> m_lyricsMatches;
+    QStringList m_fuzzyWords;
+    QVector<qreal> m_fuzzyScores;
+};
+
+#endif // __FILTER_QUERY_HH__
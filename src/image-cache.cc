@@ -0,0 +1,115 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "image-cache.hh"
+
+#include <climits>
+
+namespace
+{
+// the cost of a pixmap in a QCache is its size in bytes
+int cost(const QPixmap &pixmap)
+{
+    return qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / 8);
+}
+}
+
+ImageCache::ImageCache()
+{
+    resetStatistics();
+    // a 40k-song library has a few thousand covers of 24px and 128px
+    setBudget(Covers, 48 * 1024 * 1024);
+    setBudget(ChordDiagrams, 8 * 1024 * 1024);
+    setBudget(Icons, 2 * 1024 * 1024);
+}
+
+ImageCache::~ImageCache() {}
+
+bool ImageCache::find(Category category, const QString &key, QPixmap *pixmap)
+{
+    QPixmap *cached = m_caches[category].object(key);
+    if (!cached) {
+        ++m_counters[category].misses;
+        return false;
+    }
+    ++m_counters[category].hits;
+    *pixmap = *cached;
+    return true;
+}
+
+void ImageCache::insert(Category category, const QString &key,
+                        const QPixmap &pixmap)
+{
+    QCache<QString, QPixmap> &cache = m_caches[category];
+    int expected = cache.size() + (cache.contains(key) ? 0 : 1);
+    cache.insert(key, new QPixmap(pixmap), cost(pixmap));
+    m_counters[category].evictions += expected - cache.size();
+}
+
+void ImageCache::remove(Category category, const QString &key)
+{
+    m_caches[category].remove(key);
+}
+
+qint64 ImageCache::budget(Category category) const
+{
+    return m_caches[category].maxCost();
+}
+
+void ImageCache::setBudget(Category category, qint64 bytes)
+{
+    QCache<QString, QPixmap> &cache = m_caches[category];
+    int count = cache.size();
+    cache.setMaxCost(int(qBound(qint64(0), bytes, qint64(INT_MAX))));
+    m_counters[category].evictions += count - cache.size();
+}
+
+ImageCache::Statistics ImageCache::statistics(Category category) const
+{
+    Statistics statistics;
+    statistics.hits = m_counters[category].hits;
+    statistics.misses = m_counters[category].misses;
+    statistics.evictions = m_counters[category].evictions;
+    statistics.bytes = m_caches[category].totalCost();
+    statistics.budget = m_caches[category].maxCost();
+    statistics.count = m_caches[category].size();
+    return statistics;
+}
+
+void ImageCache::resetStatistics()
+{
+    for (int i = 0; i < CategoryCount; ++i) {
+        m_counters[i].hits = 0;
+        m_counters[i].misses = 0;
+        m_counters[i].evictions = 0;
+    }
+}
+
+QString ImageCache::categoryName(Category category)
+{
+    switch (category) {
+    case Covers:
+        return tr("Covers");
+    case ChordDiagrams:
+        return tr("Chord diagrams");
+    case Icons:
+        return tr("Icons");
+    default:
+        return QString();
+    }
+}
@@ -0,0 +1,141 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __IMAGE_CACHE_HH__
+#define __IMAGE_CACHE_HH__
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QPixmap>
+#include <QString>
+
+#include "singleton.hh"
+
+/*!
+  \file image-cache.hh
+  \class ImageCache
+  \brief ImageCache is the in-memory cache of the pixmaps drawn by the views
+
+  Pixmaps are stored by category, each category having its own budget
+  in bytes, so that chord diagrams or flags never evict the covers of
+  the library, and the other way around. Within a category, the least
+  recently used pixmaps are evicted first.
+
+  Keys must identify the pixmap without ambiguity within a category;
+  covers are keyed by their full path and size.
+
+  The number of hits, misses and evictions of each category is
+  counted, see statistics().
+*/
+class ImageCache : public Singleton<ImageCache>
+{
+    Q_DECLARE_TR_FUNCTIONS(ImageCache)
+
+    friend class Singleton<ImageCache>;
+
+private:
+    /// Constructor.
+    ImageCache();
+    /// Destructor.
+    ~ImageCache();
+
+public:
+    /*!
+    \enum Category
+    Categories of cached pixmaps.
+  */
+    enum Category {
+        Covers = 0,        /*!< album covers and their placeholders.*/
+        ChordDiagrams = 1, /*!< guitar and ukulele chord diagrams.*/
+        Icons = 2,         /*!< flags and other icons of the views.*/
+        CategoryCount = 3
+    };
+
+    /*!
+    \struct Statistics
+    Usage of a category of the cache.
+  */
+    struct Statistics {
+        qint64 hits;      /*!< lookups that found a pixmap.*/
+        qint64 misses;    /*!< lookups that did not.*/
+        qint64 evictions; /*!< pixmaps removed to respect the budget.*/
+        qint64 bytes;     /*!< memory used by the cached pixmaps.*/
+        qint64 budget;    /*!< maximum memory for the category.*/
+        int count;        /*!< number of cached pixmaps.*/
+    };
+
+    /*!
+    Looks for the pixmap \a key of \a category and copies it in
+    \a pixmap. Returns \a false if it is not cached.
+    \sa insert
+  */
+    bool find(Category category, const QString &key, QPixmap *pixmap);
+
+    /*!
+    Caches \a pixmap as \a key within \a category, evicting the least
+    recently used pixmaps of the category if needed.
+    \sa find, remove
+  */
+    void insert(Category category, const QString &key, const QPixmap &pixmap);
+
+    /*!
+    Removes the pixmap \a key of \a category.
+    \sa insert
+  */
+    void remove(Category category, const QString &key);
+
+    /*!
+    Returns the maximum memory in bytes used by \a category.
+    \sa setBudget
+  */
+    qint64 budget(Category category) const;
+
+    /*!
+    Sets the maximum memory in bytes used by \a category.
+    \sa budget
+  */
+    void setBudget(Category category, qint64 bytes);
+
+    /*!
+    Returns the usage of \a category since the last reset.
+    \sa resetStatistics
+  */
+    Statistics statistics(Category category) const;
+
+    /*!
+    Resets the hit, miss and eviction counters.
+  */
+    void resetStatistics();
+
+    /*!
+    Returns the translated name of \a category.
+  */
+    static QString categoryName(Category category);
+
+private:
+    struct Counters {
+        qint64 hits;
+        qint64 misses;
+        qint64 evictions;
+    };
+
+    QCache<QString, QPixmap> m_caches[CategoryCount];
+    Counters m_counters[CategoryCount];
+};
+
+#endif // __IMAGE_CACHE_HH__
@@ -22,6 +22,7 @@
 #include "file-chooser.hh"
 #include "main-window.hh"
 #include "library.hh"
+#include "library-path-checker.hh"
 #include "progress-bar.hh"
 
 #include <QDir>
@@ -61,6 +62,7 @@ ImportDialog::ImportDialog(QWidget *parent)
     : QDialog(parent)
     , m_libraryPath(new FileChooser(this))
     , m_libraryPathValid(new QLabel(this))
+    , m_libraryPathChecker(new LibraryPathChecker(this))
     , m_songsToBeImported(QStringList())
 #ifdef ENABLE_LIBRARY_DOWNLOAD
     , m_manager(0)
@@ -80,6 +82,8 @@ ImportDialog::ImportDialog(QWidget *parent)
     m_libraryPath->setCaption(tr("Library path"));
     connect(m_libraryPath, SIGNAL(pathChanged(const QString &)), this,
             SLOT(checkLibraryPath(const QString &)));
+    connect(m_libraryPathChecker, SIGNAL(checked(const QString &)),
+            m_libraryPathValid, SLOT(setText(const QString &)));
     checkLibraryPath(m_libraryPath->path());
 
     QGroupBox *pathGroupBox = new QGroupBox(tr("Library"));
@@ -257,7 +261,7 @@ void ImportDialog::setParent(MainWindow *parent) { m_parent = parent; }
 
 void ImportDialog::checkLibraryPath(const QString &path)
 {
-    m_libraryPathValid->setText(Library::checkPath(path));
+    m_libraryPathChecker->check(path);
 }
 
 void ImportDialog::setLocalSubWidgetsVisible(const bool value)
@@ -45,6 +45,7 @@ class QNetworkReply;
 
 class ProgressBar;
 class FileChooser;
+class LibraryPathChecker;
 class MainWindow;
 
 /*!
@@ -129,6 +130,7 @@ private:
     MainWindow *m_parent;
     FileChooser *m_libraryPath;
     QLabel *m_libraryPathValid;
+    LibraryPathChecker *m_libraryPathChecker;
 
     QRadioButton *m_fromLocalButton;
     QRadioButton *m_fromNetworkButton;
@@ -0,0 +1,213 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "library-index.hh"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QDataStream>
+
+#include <QDebug>
+
+namespace
+{
+void intern(QSet<QString> &strings, QString &string)
+{
+    QSet<QString>::const_iterator it = strings.constFind(string);
+    if (it != strings.constEnd())
+        string = *it;
+    else
+        strings.insert(string);
+}
+}
+
+const quint32 LibraryIndex::_magic = 0x50474958; // "PGIX"
+const quint32 LibraryIndex::_version = 3;
+
+LibraryIndex::LibraryIndex() : m_filename(), m_entries(), m_modified(false) {}
+
+LibraryIndex::~LibraryIndex() {}
+
+QString LibraryIndex::filename() const { return m_filename; }
+
+void LibraryIndex::setFilename(const QString &filename)
+{
+    if (m_filename != filename) {
+        m_filename = filename;
+        clear();
+        m_modified = false;
+    }
+}
+
+bool LibraryIndex::load()
+{
+    clear();
+    m_modified = false;
+
+    QFile file(filename());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version, count;
+    in >> magic >> version;
+    if (magic != _magic || version != _version) {
+        qWarning() << "LibraryIndex::load: discarding outdated index"
+                   << filename();
+        return false;
+    }
+
+    in >> count;
+    m_entries.reserve(count);
+    QString path;
+    Entry entry;
+    QSet<QString> strings;
+    QSet<QString> words;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        in >> path >> entry.lastModified >> entry.size >> entry.song
+            >> entry.hasWords >> entry.words;
+
+        // songs of a same artist or album share their strings
+        intern(strings, entry.song.artist);
+        intern(strings, entry.song.album);
+        intern(strings, entry.song.coverPath);
+        intern(strings, entry.song.coverName);
+        intern(strings, entry.song.url);
+        for (int j = 0; j < entry.words.size(); ++j)
+            intern(words, entry.words[j]);
+        m_entries.insert(path, entry);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "LibraryIndex::load: corrupted index" << filename();
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool LibraryIndex::save()
+{
+    if (!m_modified || filename().isEmpty())
+        return true;
+
+    // the previous index is only replaced once the new one is fully
+    // written
+    QDir().mkpath(QFileInfo(filename()).absolutePath());
+    QSaveFile file(filename());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "LibraryIndex::save: unable to open" << filename();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << _magic << _version << quint32(m_entries.size());
+
+    QHash<QString, Entry>::const_iterator it;
+    for (it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        out << it.key() << it.value().lastModified << it.value().size
+            << it.value().song << it.value().hasWords << it.value().words;
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "LibraryIndex::save: unable to write" << filename();
+        return false;
+    }
+
+    m_modified = false;
+    return true;
+}
+
+void LibraryIndex::clear()
+{
+    if (!m_entries.isEmpty())
+        m_modified = true;
+    m_entries.clear();
+}
+
+bool LibraryIndex::find(const QFileInfo &fileInfo, Song *song) const
+{
+    QHash<QString, Entry>::const_iterator it =
+        m_entries.constFind(fileInfo.filePath());
+    if (it == m_entries.constEnd() ||
+        it.value().lastModified != fileInfo.lastModified().toMSecsSinceEpoch() ||
+        it.value().size != fileInfo.size())
+        return false;
+
+    if (song)
+        (*song) = it.value().song;
+    return true;
+}
+
+void LibraryIndex::insert(const QFileInfo &fileInfo, const Song &song)
+{
+    Entry entry;
+    entry.lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    entry.size = fileInfo.size();
+    entry.song = song;
+    entry.hasWords = false;
+    m_entries.insert(fileInfo.filePath(), entry);
+    m_modified = true;
+}
+
+bool LibraryIndex::findWords(const QString &path, QStringList *words) const
+{
+    QHash<QString, Entry>::const_iterator it = m_entries.constFind(path);
+    if (it == m_entries.constEnd() || !it.value().hasWords)
+        return false;
+
+    if (words)
+        (*words) = it.value().words;
+    return true;
+}
+
+void LibraryIndex::setWords(const QString &path, const QStringList &words)
+{
+    QHash<QString, Entry>::iterator it = m_entries.find(path);
+    if (it == m_entries.end())
+        return;
+
+    it.value().hasWords = true;
+    it.value().words = words;
+    m_modified = true;
+}
+
+void LibraryIndex::remove(const QString &path)
+{
+    if (m_entries.remove(path) > 0)
+        m_modified = true;
+}
+
+void LibraryIndex::prune(const QSet<QString> &paths)
+{
+    QHash<QString, Entry>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (!paths.contains(it.key())) {
+            it = m_entries.erase(it);
+            m_modified = true;
+        } else {
+            ++it;
+        }
+    }
+}
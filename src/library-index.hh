@@ -0,0 +1,153 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __LIBRARY_INDEX_HH__
+#define __LIBRARY_INDEX_HH__
+
+#include "song.hh"
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+
+class QFileInfo;
+
+/*!
+  \file library-index.hh
+  \class LibraryIndex
+  \brief LibraryIndex is the on-disk cache of the parsed songs of a Library
+
+  A LibraryIndex associates the absolute path of each .sg file of a
+  library with its Song object, along with the modification time and
+  the size of the file at the time it was parsed. Once the lyrics of
+  a file have been read, its entry also holds their folded words (see
+  LyricsIndex::words).
+
+  The index is stored as a versioned binary file so that, on startup,
+  only new or modified files have to be parsed again.
+*/
+class LibraryIndex
+{
+public:
+    /// Constructor.
+    LibraryIndex();
+
+    /// Destructor.
+    ~LibraryIndex();
+
+    /*!
+    Returns the file in which the index is stored.
+    \sa setFilename
+  */
+    QString filename() const;
+
+    /*!
+    Sets \a filename as the file in which the index is stored.
+    Entries from a previous file are discarded.
+    \sa filename, load
+  */
+    void setFilename(const QString &filename);
+
+    /*!
+    Reads the index from its file.
+    Returns \a false if the file does not exist, is corrupted or
+    was written by an incompatible version of the application.
+    \sa save
+  */
+    bool load();
+
+    /*!
+    Writes the index to its file if it has been modified since
+    it was loaded. The file is replaced atomically: if the write
+    fails, the previous index is left untouched.
+    \sa load
+  */
+    bool save();
+
+    /*!
+    Removes all entries from the index.
+  */
+    void clear();
+
+    /*!
+    Returns \a true if the index holds an up-to-date entry for the
+    file \a fileInfo; the corresponding Song object is copied in \a song.
+    \sa insert
+  */
+    bool find(const QFileInfo &fileInfo, Song *song) const;
+
+    /*!
+    Stores \a song as the parsed contents of the file \a fileInfo.
+    \sa find, remove
+  */
+    void insert(const QFileInfo &fileInfo, const Song &song);
+
+    /*!
+    Returns \a true if the words of the lyrics of the file \a path
+    are known; they are copied in \a words.
+    \sa setWords
+  */
+    bool findWords(const QString &path, QStringList *words) const;
+
+    /*!
+    Stores \a words as the words of the lyrics of the file \a path.
+    Entries of files that are not in the index are not created.
+    The words are dropped when the entry is replaced by insert().
+    \sa findWords
+  */
+    void setWords(const QString &path, const QStringList &words);
+
+    /*!
+    Removes the entry of the file \a path.
+    \sa insert
+  */
+    void remove(const QString &path);
+
+    /*!
+    Removes the entries of the files that are not in \a paths.
+    \sa remove
+  */
+    void prune(const QSet<QString> &paths);
+
+private:
+    struct Entry {
+        qint64 lastModified; /*!< modification time (ms since epoch).*/
+        qint64 size;         /*!< size of the file in bytes.*/
+        Song song;           /*!< parsed contents of the file.*/
+        bool hasWords;       /*!< whether the words are known.*/
+        QStringList words;   /*!< folded words of the lyrics.*/
+    };
+
+    /*!
+    Identifies index files; stored at the beginning of the file.
+  */
+    static const quint32 _magic;
+
+    /*!
+    Version of the index format. It has to be increased whenever
+    the serialization of entries or of Song objects changes.
+  */
+    static const quint32 _version;
+
+    QString m_filename;
+    QHash<QString, Entry> m_entries;
+    bool m_modified;
+};
+
+#endif // __LIBRARY_INDEX_HH__
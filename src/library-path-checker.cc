@@ -0,0 +1,80 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "library-path-checker.hh"
+
+#include "library.hh"
+
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+namespace
+{
+// the shared flag outlives the checker if the walk is still running
+QString checkPath(const QString &path, QSharedPointer<QAtomicInt> canceled)
+{
+    return Library::checkPath(path, canceled.data());
+}
+}
+
+LibraryPathChecker::LibraryPathChecker(QObject *parent)
+    : QObject(parent)
+    , m_path()
+    , m_timer(new QTimer(this))
+    , m_watcher(new QFutureWatcher<QString>(this))
+    , m_canceled()
+{
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(300);
+    connect(m_timer, SIGNAL(timeout()), SLOT(start()));
+    connect(m_watcher, SIGNAL(finished()), SLOT(finished()));
+}
+
+LibraryPathChecker::~LibraryPathChecker() { cancel(); }
+
+void LibraryPathChecker::check(const QString &path)
+{
+    cancel();
+    m_path = path;
+    m_timer->start();
+}
+
+void LibraryPathChecker::cancel()
+{
+    if (m_canceled) {
+        m_canceled->store(1);
+        m_canceled.clear();
+    }
+}
+
+void LibraryPathChecker::start()
+{
+    m_canceled = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+    m_watcher->setFuture(QtConcurrent::run(checkPath, m_path, m_canceled));
+}
+
+void LibraryPathChecker::finished()
+{
+    // a check superseded by a newer one has been canceled
+    if (!m_canceled || m_canceled->load())
+        return;
+
+    m_canceled.clear();
+    emit(checked(m_watcher->result()));
+}
@@ -0,0 +1,80 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __LIBRARY_PATH_CHECKER_HH__
+#define __LIBRARY_PATH_CHECKER_HH__
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+#include <QSharedPointer>
+
+class QTimer;
+template <typename T> class QFutureWatcher;
+
+/*!
+  \file library-path-checker.hh
+  \class LibraryPathChecker
+  \brief LibraryPathChecker validates a library path in the background
+
+  Paths given to check() are debounced, so that typing a path in a
+  FileChooser only walks the last one. The walk itself runs on the
+  global thread pool; starting a new check cancels the previous one,
+  whose result is discarded.
+
+  \sa Library::checkPath
+*/
+class LibraryPathChecker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    LibraryPathChecker(QObject *parent = 0);
+
+    /// Destructor.
+    ~LibraryPathChecker();
+
+public slots:
+    /*!
+    Schedules the validation of \a path.
+    The checked() signal is emitted once it is done.
+  */
+    void check(const QString &path);
+
+signals:
+    /*!
+    This signal is emitted with the rich text \a message describing
+    the last path given to check().
+  */
+    void checked(const QString &message);
+
+private slots:
+    void start();
+    void finished();
+
+private:
+    void cancel();
+
+    QString m_path;
+    QTimer *m_timer;
+    QFutureWatcher<QString> *m_watcher;
+    QSharedPointer<QAtomicInt> m_canceled;
+};
+
+#endif // __LIBRARY_PATH_CHECKER_HH__
@@ -0,0 +1,300 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "library-store.hh"
+
+#include "text-folding.hh"
+
+namespace
+{
+qint8 toCompactInt(int value) { return qint8(qBound(-128, value, 127)); }
+}
+
+int LibraryStore::StringPool::insert(const QString &string)
+{
+    QHash<QString, int>::const_iterator it = m_ids.constFind(string);
+    if (it != m_ids.constEnd()) {
+        ++m_counts[it.value()];
+        return it.value();
+    }
+
+    int id;
+    if (!m_freeIds.isEmpty()) {
+        id = m_freeIds.takeLast();
+        m_strings[id] = string;
+        m_counts[id] = 1;
+    } else {
+        id = m_strings.size();
+        m_strings << string;
+        m_counts << 1;
+    }
+    m_ids.insert(string, id);
+    return id;
+}
+
+void LibraryStore::StringPool::release(int id)
+{
+    if (--m_counts[id] > 0)
+        return;
+
+    m_ids.remove(m_strings[id]);
+    m_strings[id] = QString();
+    m_freeIds << id;
+}
+
+void LibraryStore::StringPool::clear()
+{
+    m_strings.clear();
+    m_counts.clear();
+    m_freeIds.clear();
+    m_ids.clear();
+}
+
+LibraryStore::LibraryStore()
+    : m_titles()
+    , m_paths()
+    , m_searchKeys()
+    , m_artists()
+    , m_albums()
+    , m_coverPaths()
+    , m_coverNames()
+    , m_originalSongs()
+    , m_urls()
+    , m_languages()
+    , m_columnCounts()
+    , m_capos()
+    , m_transposes()
+    , m_flags()
+    , m_artistPool()
+    , m_albumPool()
+    , m_directoryPool()
+    , m_stringPool()
+    , m_trigramIndex()
+{
+}
+
+LibraryStore::~LibraryStore() {}
+
+int LibraryStore::size() const { return m_paths.size(); }
+
+void LibraryStore::clear()
+{
+    m_titles.clear();
+    m_paths.clear();
+    m_searchKeys.clear();
+    m_artists.clear();
+    m_albums.clear();
+    m_coverPaths.clear();
+    m_coverNames.clear();
+    m_originalSongs.clear();
+    m_urls.clear();
+    m_languages.clear();
+    m_columnCounts.clear();
+    m_capos.clear();
+    m_transposes.clear();
+    m_flags.clear();
+
+    m_artistPool.clear();
+    m_albumPool.clear();
+    m_directoryPool.clear();
+    m_stringPool.clear();
+
+    m_trigramIndex.clear();
+}
+
+void LibraryStore::reserve(int size)
+{
+    m_titles.reserve(size);
+    m_paths.reserve(size);
+    m_searchKeys.reserve(size);
+    m_artists.reserve(size);
+    m_albums.reserve(size);
+    m_coverPaths.reserve(size);
+    m_coverNames.reserve(size);
+    m_originalSongs.reserve(size);
+    m_urls.reserve(size);
+    m_languages.reserve(size);
+    m_columnCounts.reserve(size);
+    m_capos.reserve(size);
+    m_transposes.reserve(size);
+    m_flags.reserve(size);
+}
+
+void LibraryStore::append(const Song &song)
+{
+    int row = size();
+    m_titles.resize(row + 1);
+    m_paths.resize(row + 1);
+    m_searchKeys.resize(row + 1);
+    m_artists.resize(row + 1);
+    m_albums.resize(row + 1);
+    m_coverPaths.resize(row + 1);
+    m_coverNames.resize(row + 1);
+    m_originalSongs.resize(row + 1);
+    m_urls.resize(row + 1);
+    m_languages.resize(row + 1);
+    m_columnCounts.resize(row + 1);
+    m_capos.resize(row + 1);
+    m_transposes.resize(row + 1);
+    m_flags.resize(row + 1);
+    set(row, song);
+}
+
+void LibraryStore::replace(int row, const Song &song)
+{
+    release(row);
+    set(row, song);
+}
+
+void LibraryStore::set(int row, const Song &song)
+{
+    m_titles[row] = song.title;
+    m_paths[row] = song.path;
+    m_searchKeys[row] = fold(song.title) + QLatin1Char('\n') +
+                        fold(song.artist) + QLatin1Char('\n') +
+                        fold(song.album);
+    m_trigramIndex.insert(row, m_searchKeys[row]);
+    m_artists[row] = m_artistPool.insert(song.artist);
+    m_albums[row] = m_albumPool.insert(song.album);
+    m_coverPaths[row] = m_directoryPool.insert(song.coverPath);
+    m_coverNames[row] = m_stringPool.insert(song.coverName);
+    m_originalSongs[row] = m_stringPool.insert(song.originalSong);
+    m_urls[row] = m_stringPool.insert(song.url);
+    m_languages[row] = quint16(song.locale.language());
+    m_columnCounts[row] = toCompactInt(song.columnCount);
+    m_capos[row] = toCompactInt(song.capo);
+    m_transposes[row] = toCompactInt(song.transpose);
+    m_flags[row] =
+        (song.isLilypond ? Lilypond : 0) | (song.isWebsite ? Website : 0);
+}
+
+void LibraryStore::release(int row)
+{
+    m_artistPool.release(m_artists[row]);
+    m_albumPool.release(m_albums[row]);
+    m_directoryPool.release(m_coverPaths[row]);
+    m_stringPool.release(m_coverNames[row]);
+    m_stringPool.release(m_originalSongs[row]);
+    m_stringPool.release(m_urls[row]);
+}
+
+void LibraryStore::remove(int first, int last)
+{
+    for (int row = first; row <= last; ++row)
+        release(row);
+
+    int count = last - first + 1;
+    m_titles.remove(first, count);
+    m_paths.remove(first, count);
+    m_searchKeys.remove(first, count);
+    m_artists.remove(first, count);
+    m_albums.remove(first, count);
+    m_coverPaths.remove(first, count);
+    m_coverNames.remove(first, count);
+    m_originalSongs.remove(first, count);
+    m_urls.remove(first, count);
+    m_languages.remove(first, count);
+    m_columnCounts.remove(first, count);
+    m_capos.remove(first, count);
+    m_transposes.remove(first, count);
+    m_flags.remove(first, count);
+
+    m_trigramIndex.remove(first, last);
+}
+
+Song LibraryStore::song(int row) const
+{
+    Song song;
+    song.title = title(row);
+    song.artist = artist(row);
+    song.album = album(row);
+    song.originalSong = originalSong(row);
+    song.url = url(row);
+    song.coverName = coverName(row);
+    song.coverPath = coverPath(row);
+    song.path = path(row);
+    song.locale = QLocale(language(row), QLocale::AnyCountry);
+    song.isLilypond = isLilypond(row);
+    song.isWebsite = isWebsite(row);
+    song.columnCount = columnCount(row);
+    song.capo = capo(row);
+    song.transpose = transpose(row);
+    return song;
+}
+
+const QString &LibraryStore::title(int row) const { return m_titles[row]; }
+
+const QString &LibraryStore::artist(int row) const
+{
+    return m_artistPool.at(m_artists[row]);
+}
+
+const QString &LibraryStore::album(int row) const
+{
+    return m_albumPool.at(m_albums[row]);
+}
+
+const QString &LibraryStore::originalSong(int row) const
+{
+    return m_stringPool.at(m_originalSongs[row]);
+}
+
+const QString &LibraryStore::url(int row) const
+{
+    return m_stringPool.at(m_urls[row]);
+}
+
+const QString &LibraryStore::coverName(int row) const
+{
+    return m_stringPool.at(m_coverNames[row]);
+}
+
+const QString &LibraryStore::coverPath(int row) const
+{
+    return m_directoryPool.at(m_coverPaths[row]);
+}
+
+const QString &LibraryStore::path(int row) const { return m_paths[row]; }
+
+QLocale::Language LibraryStore::language(int row) const
+{
+    return QLocale::Language(m_languages[row]);
+}
+
+bool LibraryStore::isLilypond(int row) const
+{
+    return m_flags[row] & Lilypond;
+}
+
+bool LibraryStore::isWebsite(int row) const { return m_flags[row] & Website; }
+
+int LibraryStore::columnCount(int row) const { return m_columnCounts[row]; }
+
+int LibraryStore::capo(int row) const { return m_capos[row]; }
+
+int LibraryStore::transpose(int row) const { return m_transposes[row]; }
+
+const QString &LibraryStore::searchKey(int row) const
+{
+    return m_searchKeys[row];
+}
+
+const TrigramIndex &LibraryStore::trigramIndex() const
+{
+    return m_trigramIndex;
+}
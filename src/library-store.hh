@@ -0,0 +1,181 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __LIBRARY_STORE_HH__
+#define __LIBRARY_STORE_HH__
+
+#include "song.hh"
+#include "trigram-index.hh"
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QLocale>
+
+/*!
+  \file library-store.hh
+  \class LibraryStore
+  \brief LibraryStore holds the songs of a Library column by column
+
+  Instead of a list of Song objects, a LibraryStore keeps one array
+  per field of the songs. Artists, albums, cover directories and the
+  other repetitive strings are interned: each distinct value is stored
+  once and the columns only hold its identifier; values are dropped
+  once no song uses them any more. Languages, capo,
+  transposition and flags are stored as compact integers.
+
+  Song objects are rebuilt on demand with song().
+
+  Each song also has a search key, made of its title, artist and album
+  folded once for all (see text-folding.hh), so that filters compare
+  keywords without converting the fields again. The words of the
+  search keys are also kept in a TrigramIndex for fuzzy searches.
+
+  Copies of a store share its columns until one of them is modified,
+  so a copy is a cheap snapshot that other threads may read.
+*/
+class LibraryStore
+{
+public:
+    /// Constructor.
+    LibraryStore();
+
+    /// Destructor.
+    ~LibraryStore();
+
+    /*!
+    Returns the number of songs in the store.
+  */
+    int size() const;
+
+    /*!
+    Removes all songs from the store.
+  */
+    void clear();
+
+    /*!
+    Allocates memory for at least \a size songs.
+  */
+    void reserve(int size);
+
+    /*!
+    Appends \a song at the end of the store.
+    \sa replace, remove
+  */
+    void append(const Song &song);
+
+    /*!
+    Replaces the song at position \a row by \a song.
+    \sa append
+  */
+    void replace(int row, const Song &song);
+
+    /*!
+    Removes the songs from position \a first to position \a last.
+    \sa append
+  */
+    void remove(int first, int last);
+
+    /*!
+    Returns the song at position \a row.
+  */
+    Song song(int row) const;
+
+    const QString &title(int row) const;
+    const QString &artist(int row) const;
+    const QString &album(int row) const;
+    const QString &originalSong(int row) const;
+    const QString &url(int row) const;
+    const QString &coverName(int row) const;
+    const QString &coverPath(int row) const;
+    const QString &path(int row) const;
+    QLocale::Language language(int row) const;
+    bool isLilypond(int row) const;
+    bool isWebsite(int row) const;
+    int columnCount(int row) const;
+    int capo(int row) const;
+    int transpose(int row) const;
+
+    /*!
+    Returns the folded title, artist and album of the song at
+    position \a row, separated by line breaks.
+  */
+    const QString &searchKey(int row) const;
+
+    /*!
+    Returns the trigram index of the search keys, whose rows are the
+    rows of the store.
+  */
+    const TrigramIndex &trigramIndex() const;
+
+private:
+    /*!
+      \class StringPool
+      Associates each distinct string with an identifier. Identifiers
+      are reference counted: a string is dropped once it is released
+      as many times as it was inserted, and its identifier is reused.
+    */
+    class StringPool
+    {
+    public:
+        int insert(const QString &string);
+        void release(int id);
+        const QString &at(int id) const { return m_strings[id]; }
+        void clear();
+
+    private:
+        QVector<QString> m_strings;
+        QVector<int> m_counts;
+        QVector<int> m_freeIds;
+        QHash<QString, int> m_ids;
+    };
+
+    enum Flag {
+        Lilypond = 0x1, /*!< the song contains lilypond music sheets.*/
+        Website = 0x2   /*!< the song contains a link to a website.*/
+    };
+
+    void set(int row, const Song &song);
+    void release(int row);
+
+    QVector<QString> m_titles;
+    QVector<QString> m_paths;
+    QVector<QString> m_searchKeys;
+
+    QVector<int> m_artists;
+    QVector<int> m_albums;
+    QVector<int> m_coverPaths;
+    QVector<int> m_coverNames;
+    QVector<int> m_originalSongs;
+    QVector<int> m_urls;
+
+    QVector<quint16> m_languages;
+    QVector<qint8> m_columnCounts;
+    QVector<qint8> m_capos;
+    QVector<qint8> m_transposes;
+    QVector<quint8> m_flags;
+
+    StringPool m_artistPool;
+    StringPool m_albumPool;
+    StringPool m_directoryPool;
+    StringPool m_stringPool;
+
+    TrigramIndex m_trigramIndex;
+};
+
+#endif // __LIBRARY_STORE_HH__
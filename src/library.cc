@@ -21,15 +21,29 @@
 #include "main-window.hh"
 #include "progress-bar.hh"
 #include "conflict-dialog.hh"
+#include "completion-model.hh"
+#include "song-writer.hh"
+#include "thumbnailer.hh"
+#include "text-folding.hh"
+#include "lyrics-index.hh"
 
-#include <QStringListModel>
 #include <QDirIterator>
-#include <QPixmapCache>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QPixmap>
+#include <QtConcurrent>
 #include <QStatusBar>
 #include <QDesktopServices>
 #include <QSettings>
 #include <QMessageBox>
 #include <QMap>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+
+#include <algorithm>
 
 #include <QDebug>
 
@@ -37,36 +51,174 @@ namespace // anonymous namespace
 {
 QString stringToFilename(const QString &string, const QString &separator)
 {
-    QString result(string.toLower());
+    QString result;
+    result.reserve(string.size() + 4);
+
+    bool afterSeparator = false;
+    const QChar *end = string.constData() + string.size();
+    for (const QChar *it = string.constData(); it != end; ++it) {
+        // strip combining marks
+        if (it->isMark())
+            continue;
+
+        // replace non-word characters with separator
+        if (!it->isLetterOrNumber() && *it != QLatin1Char('_')) {
+            if (!afterSeparator)
+                result.append(separator);
+            afterSeparator = true;
+            continue;
+        }
+        afterSeparator = false;
 
-    // replace whitespaces with separator
-    result.replace(QRegExp("\\W+"), separator);
-    result.remove(QRegExp(QString("%1+$").arg(separator)));
+        // replace accented letters with their base letter
+        appendFolded(result, *it);
+    }
 
-    // replace utf8 characters
-    result.replace(QRegExp("[àâ]"), "a");
-    result.replace(QRegExp("[ïî]"), "i");
-    result.replace(QRegExp("[óô]"), "o");
-    result.replace(QRegExp("[ùúû]"), "u");
-    result.replace(QRegExp("[éèêë]"), "e");
-    result.replace(QString("ñ"), "n");
-    result.replace(QString("ç"), "c");
+    if (!separator.isEmpty())
+        while (result.endsWith(separator))
+            result.chop(separator.size());
 
     return result;
 }
+
+QString indexFilename(const QDir &directory)
+{
+    // one index per library, named after its directory
+    QByteArray hash =
+        QCryptographicHash::hash(directory.absolutePath().toUtf8(),
+                                 QCryptographicHash::Sha1)
+            .toHex();
+    return QString("%1/library-%2.idx")
+        .arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+        .arg(QString(hash));
+}
+
+// the library only keeps the header of the songs
+Song songHeader(const Song &song)
+{
+    Song header(song);
+    header.gtabs.clear();
+    header.utabs.clear();
+    header.lyrics.clear();
+    header.scripture.clear();
+    return header;
+}
+
+QString parentDirectory(const QString &path)
+{
+    return path.left(path.lastIndexOf('/'));
+}
+
+/*!
+  Returns the path of the cover \a coverName of the directory
+  \a coverPath, without extension.
+*/
+QString coverKey(const QString &coverPath, const QString &coverName)
+{
+    return coverPath + QLatin1Char('/') + coverName;
+}
+
+/*!
+  Adds \a row to the sorted rows of \a key in \a rowIndex.
+*/
+void insertRow(QHash<QString, QVector<int> > &rowIndex, const QString &key,
+               int row)
+{
+    QVector<int> &rows = rowIndex[key];
+    rows.insert(std::lower_bound(rows.begin(), rows.end(), row), row);
+}
+
+/*!
+  Removes \a row from the rows of \a key in \a rowIndex.
+*/
+void removeRow(QHash<QString, QVector<int> > &rowIndex, const QString &key,
+               int row)
+{
+    QHash<QString, QVector<int> >::iterator it = rowIndex.find(key);
+    if (it == rowIndex.end())
+        return;
+
+    QVector<int> &rows = it.value();
+    QVector<int>::iterator position =
+        std::lower_bound(rows.begin(), rows.end(), row);
+    if (position != rows.end() && *position == row)
+        rows.erase(position);
+    if (rows.isEmpty())
+        rowIndex.erase(it);
+}
+
+/*!
+  Moves up the rows of \a rowIndex that follow the removed rows from
+  \a first to \a last.
+*/
+void shiftRows(QHash<QString, QVector<int> > &rowIndex, int first, int last)
+{
+    int count = last - first + 1;
+    QHash<QString, QVector<int> >::iterator it = rowIndex.begin();
+    for (; it != rowIndex.end(); ++it) {
+        QVector<int> &rows = it.value();
+        for (int i = rows.size() - 1; i >= 0 && rows[i] > last; --i)
+            rows[i] -= count;
+    }
+}
 }
 
 Library::Library()
     : QAbstractTableModel()
     , m_directory()
-    , m_completionModel(new QStringListModel(this))
-    , m_artistCompletionModel(new QStringListModel(this))
-    , m_albumCompletionModel(new QStringListModel(this))
-    , m_urlCompletionModel(new QStringListModel(this))
+    , m_completionModel(new CompletionModel(this))
+    , m_artistCompletionModel(new CompletionModel(this))
+    , m_albumCompletionModel(new CompletionModel(this))
+    , m_urlCompletionModel(new CompletionModel(this))
     , m_templates()
     , m_songs()
+    , m_rows()
+    , m_coverRows()
+    , m_directoryRows()
+    , m_index()
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_watcherTimer(new QTimer(this))
+    , m_modifiedDirectories()
+    , m_parseWatcher(new QFutureWatcher<Song>(this))
+    , m_flushTimer(new QTimer(this))
+    , m_parsedSongs()
+    , m_parsedFiles()
+    , m_writer(new SongWriter(this))
+    , m_lyricsIndex(new LyricsIndex(this))
 {
     connect(this, SIGNAL(directoryChanged(const QDir &)), SLOT(update()));
+
+    // parsed songs are inserted by batches, at least every 50 ms
+    m_flushTimer->setInterval(50);
+    connect(m_flushTimer, SIGNAL(timeout()), SLOT(insertParsedSongs()));
+    connect(m_parseWatcher, SIGNAL(resultsReadyAt(int, int)),
+            SLOT(songsParsed(int, int)));
+    connect(m_parseWatcher, SIGNAL(finished()), SLOT(parsingFinished()));
+
+    // wait for a burst of modifications (git pull, rsync...) to be
+    // over before updating the library
+    m_watcherTimer->setSingleShot(true);
+    m_watcherTimer->setInterval(300);
+    connect(m_watcher, SIGNAL(directoryChanged(const QString &)),
+            SLOT(songsDirectoryModified(const QString &)));
+    connect(m_watcher, SIGNAL(fileChanged(const QString &)),
+            SLOT(songFileModified(const QString &)));
+    connect(m_watcherTimer, SIGNAL(timeout()),
+            SLOT(updateModifiedDirectories()));
+
+    // the words of the lyrics are kept in the index, so that only new
+    // or modified files are read again
+    connect(m_lyricsIndex,
+            SIGNAL(documentRead(const QString &, const QStringList &)),
+            SLOT(lyricsRead(const QString &, const QStringList &)));
+    connect(m_lyricsIndex, SIGNAL(built()), SLOT(lyricsIndexBuilt()));
+
+    connect(m_writer, SIGNAL(written(const QString &, bool)),
+            SIGNAL(written(const QString &, bool)));
+    connect(m_writer, SIGNAL(written(const QString &, bool)),
+            SLOT(coverWritten(const QString &, bool)));
+    connect(Thumbnailer::instance(), SIGNAL(thumbnailReady(const QString &)),
+            SLOT(coverChanged(const QString &)));
 }
 
 Library::~Library() { m_songs.clear(); }
@@ -112,6 +264,8 @@ void Library::setDirectory(const QDir &directory)
         QDir templatesDirectory(
             QString("%1/templates").arg(directory.canonicalPath()));
         m_templates = templatesDirectory.entryList(QStringList() << "*.tex");
+        m_index.setFilename(indexFilename(m_directory));
+        m_index.load();
         writeSettings();
         emit(directoryChanged(m_directory));
     }
@@ -139,6 +293,8 @@ QAbstractListModel *Library::urlCompletionModel() const
     return m_urlCompletionModel;
 }
 
+LyricsIndex *Library::lyricsIndex() const { return m_lyricsIndex; }
+
 QVariant Library::headerData(int section, Qt::Orientation orientation,
                              int role) const
 {
@@ -193,7 +349,7 @@ QVariant Library::data(const QModelIndex &index, int role) const
         case 2:
             return tr("Lilypond music sheet");
         case 3:
-            return QString("http://%1").arg(m_songs[index.row()].url);
+            return QString("http://%1").arg(m_songs.url(index.row()));
         case 5:
             return QLocale::languageToString(
                 data(index, LanguageRole).value<QLocale::Language>());
@@ -202,52 +358,39 @@ QVariant Library::data(const QModelIndex &index, int role) const
         }
         break;
     case TitleRole:
-        return m_songs[index.row()].title;
+        return m_songs.title(index.row());
     case ArtistRole:
-        return m_songs[index.row()].artist;
+        return m_songs.artist(index.row());
     case AlbumRole:
-        return m_songs[index.row()].album;
+        return m_songs.album(index.row());
     case CoverRole:
         return QString("%1/%2.jpg")
-            .arg(m_songs[index.row()].coverPath)
-            .arg(m_songs[index.row()].coverName);
+            .arg(m_songs.coverPath(index.row()))
+            .arg(m_songs.coverName(index.row()));
     case LilypondRole:
-        return m_songs[index.row()].isLilypond;
+        return m_songs.isLilypond(index.row());
     case WebsiteRole:
-        return m_songs[index.row()].isWebsite;
+        return m_songs.isWebsite(index.row());
     case UrlRole:
-        return m_songs[index.row()].url;
+        return m_songs.url(index.row());
     case LanguageRole:
-        return qVariantFromValue(m_songs[index.row()].locale.language());
+        return qVariantFromValue(m_songs.language(index.row()));
     case PathRole:
-        return m_songs[index.row()].path;
+        return m_songs.path(index.row());
     case RelativePathRole:
-        return QDir(QString("%1/songs").arg(directory().canonicalPath()))
-            .relativeFilePath(m_songs[index.row()].path);
-    case CoverSmallRole: {
-        QPixmap pixmap;
-        QFileInfo file = QFileInfo(data(index, CoverRole).toString());
-        if (file.exists()) {
-            if (!QPixmapCache::find(file.baseName() + "-small", &pixmap)) {
-                pixmap = QPixmap::fromImage(
-                    QImage(file.filePath()).scaledToWidth(24));
-                QPixmapCache::insert(file.baseName() + "-small", pixmap);
-            }
-            return pixmap;
-        }
-    }
-        return QVariant();
+        return QDir(QString("%1/songs").arg(directory().absolutePath()))
+            .relativeFilePath(m_songs.path(index.row()));
+    case CoverSmallRole:
     case CoverFullRole: {
-        QPixmap pixmap;
-        QFileInfo file = QFileInfo(data(index, CoverRole).toString());
-        if (file.exists()) {
-            if (!QPixmapCache::find(file.baseName() + "-full", &pixmap)) {
-                pixmap = QPixmap::fromImage(
-                    QImage(file.filePath()).scaled(128, 128));
-                QPixmapCache::insert(file.baseName() + "-full", pixmap);
-            }
+        if (m_songs.coverName(index.row()).isEmpty())
+            return QVariant();
+        // decoded in the background, the view draws a placeholder
+        // until thumbnailReady() is emitted
+        QSize size = (role == CoverSmallRole) ? QSize(24, 0) : QSize(128, 128);
+        QPixmap pixmap = Thumbnailer::instance()->thumbnail(
+            data(index, CoverRole).toString(), size);
+        if (!pixmap.isNull())
             return pixmap;
-        }
     }
         return QVariant();
     }
@@ -256,42 +399,148 @@ QVariant Library::data(const QModelIndex &index, int role) const
 
 void Library::update()
 {
-    m_songs.clear();
+    // a new update supersedes the loading in progress
+    if (m_parseWatcher->isRunning()) {
+        m_parseWatcher->cancel();
+        m_parseWatcher->waitForFinished();
+    }
+    m_flushTimer->stop();
+    m_parsedSongs.clear();
 
     // get the path of each song in the library
     QStringList filter = QStringList() << "*.sg";
     QString path = directory().absolutePath();
     QStringList paths;
 
+    // songs whose file did not change since they were indexed are
+    // fetched from the index; the others have to be parsed
+    QList<Song> songs;
+    QSet<QString> files;
+    Song song;
+
+    m_parsedFiles.clear();
     QDirIterator it(path, filter, QDir::NoFilter, QDirIterator::Subdirectories);
-    while (it.hasNext())
-        paths.append(it.next());
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo fileInfo = it.fileInfo();
+        files.insert(fileInfo.filePath());
+        if (m_index.find(fileInfo, &song)) {
+            songs << song;
+        } else {
+            paths << fileInfo.filePath();
+            m_parsedFiles.insert(fileInfo.filePath(), fileInfo);
+        }
+    }
+    m_index.prune(files);
+
+    beginResetModel();
+    m_songs.clear();
+    m_songs.reserve(songs.size());
+    m_rows.clear();
+    m_rows.reserve(songs.size());
+    m_coverRows.clear();
+    m_directoryRows.clear();
+    foreach (const Song &indexedSong, songs) {
+        m_rows.insert(indexedSong.path, m_songs.size());
+        m_songs.append(indexedSong);
+        indexRow(m_songs.size() - 1);
+    }
+    emit(wasModified());
+    endResetModel();
+
+    m_completionModel->clear();
+    m_artistCompletionModel->clear();
+    m_albumCompletionModel->clear();
+    m_urlCompletionModel->clear();
+    insertCompletions(0, m_songs.size() - 1);
+
+    // a full update supersedes pending modifications
+    m_watcherTimer->stop();
+    m_modifiedDirectories.clear();
+    if (!m_watcher->directories().isEmpty())
+        m_watcher->removePaths(m_watcher->directories());
+    if (!m_watcher->files().isEmpty())
+        m_watcher->removePaths(m_watcher->files());
+    watchDirectory(QString("%1/songs").arg(path));
+    watchFiles(files.toList());
 
     showMessage(tr("Updating the library..."));
-    progressBar()->setCancelable(false);
+    progressBar()->setCancelable(true);
     progressBar()->setTextVisible(true);
     progressBar()->setRange(0, paths.size());
     progressBar()->show();
+    connect(m_parseWatcher, SIGNAL(progressValueChanged(int)), progressBar(),
+            SLOT(setValue(int)), Qt::UniqueConnection);
+    connect(progressBar(), SIGNAL(canceled()), m_parseWatcher, SLOT(cancel()),
+            Qt::UniqueConnection);
+
+    // the remaining songs are parsed in the background and
+    // appended to the library as they arrive
+    m_flushTimer->start();
+    m_parseWatcher->setFuture(
+        QtConcurrent::mapped(paths, Song::headerFromFile));
+}
+
+void Library::songsParsed(int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+        m_parsedSongs << m_parseWatcher->resultAt(i);
+
+    if (m_parsedSongs.size() >= 500)
+        insertParsedSongs();
+}
+
+void Library::insertParsedSongs()
+{
+    if (m_parsedSongs.isEmpty())
+        return;
+
+    // songs saved or added while the library was loading are already
+    // listed: they are replaced rather than appended twice
+    QList<Song> newSongs;
+    foreach (const Song &song, m_parsedSongs) {
+        // files that could not be parsed give songs without a path
+        if (song.path.isEmpty())
+            continue;
+
+        if (m_parsedFiles.contains(song.path))
+            m_index.insert(m_parsedFiles.value(song.path), song);
+
+        int row = getSongIndex(song.path);
+        if (row != -1)
+            updateSong(row, song);
+        else
+            newSongs << song;
+    }
+
+    appendSongs(newSongs);
+    m_parsedSongs.clear();
+}
+
+void Library::parsingFinished()
+{
+    m_flushTimer->stop();
+    insertParsedSongs();
+    m_parsedFiles.clear();
+    m_index.save();
+
+    // the lyrics of the files parsed again are read once the headers
+    // are loaded; the words of the other files come from the index
+    QStringList paths;
+    QHash<QString, QStringList> indexedWords;
+    QStringList words;
+    for (int row = 0; row < m_songs.size(); ++row) {
+        const QString &path = m_songs.path(row);
+        if (m_index.findWords(path, &words))
+            indexedWords.insert(path, words);
+        else
+            paths << path;
+    }
+    m_lyricsIndex->build(paths);
 
-    addSongs(paths);
-
-    QStringList wordList, artistList, albumList, urlList;
-    for (int i = 0; i < rowCount(); ++i) {
-        wordList << data(index(i, 0), Library::TitleRole).toString()
-                 << data(index(i, 0), Library::ArtistRole).toString()
-                 << data(index(i, 0), Library::PathRole).toString();
-        artistList << data(index(i, 0), Library::ArtistRole).toString();
-        albumList << data(index(i, 0), Library::AlbumRole).toString();
-        urlList << data(index(i, 0), Library::UrlRole).toString();
-    }
-    wordList.removeDuplicates();
-    artistList.removeDuplicates();
-    albumList.removeDuplicates();
-    urlList.removeDuplicates();
-    m_completionModel->setStringList(wordList);
-    m_artistCompletionModel->setStringList(artistList);
-    m_albumCompletionModel->setStringList(albumList);
-    m_urlCompletionModel->setStringList(urlList);
+    QHash<QString, QStringList>::const_iterator it;
+    for (it = indexedWords.constBegin(); it != indexedWords.constEnd(); ++it)
+        m_lyricsIndex->insertWords(it.key(), it.value());
 
     progressBar()->setCancelable(true);
     progressBar()->setTextVisible(false);
@@ -299,72 +548,309 @@ void Library::update()
     progressBar()->hide();
     showMessage(tr("Library updated."));
     emit(wasModified());
+    emit(updated(directory()));
+}
+
+bool Library::isUpdating() const { return m_parseWatcher->isRunning(); }
+
+void Library::insertCompletions(int first, int last)
+{
+    QStringList words, artists, albums, urls;
+    for (int row = first; row <= last; ++row) {
+        words << m_songs.title(row) << m_songs.artist(row)
+              << m_songs.path(row);
+        artists << m_songs.artist(row);
+        albums << m_songs.album(row);
+        urls << m_songs.url(row);
+    }
+    m_completionModel->insert(words);
+    m_artistCompletionModel->insert(artists);
+    m_albumCompletionModel->insert(albums);
+    m_urlCompletionModel->insert(urls);
+}
+
+void Library::removeCompletions(int first, int last)
+{
+    for (int row = first; row <= last; ++row) {
+        m_completionModel->remove(m_songs.title(row));
+        m_completionModel->remove(m_songs.artist(row));
+        m_completionModel->remove(m_songs.path(row));
+        m_artistCompletionModel->remove(m_songs.artist(row));
+        m_albumCompletionModel->remove(m_songs.album(row));
+        m_urlCompletionModel->remove(m_songs.url(row));
+    }
+}
+
+void Library::watchDirectory(const QString &path)
+{
+    if (!QDir(path).exists())
+        return;
+
+    QStringList directories(path);
+    QDirIterator it(path, QDir::Dirs | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext())
+        directories << it.next();
+
+    m_watcher->addPaths(directories);
+}
+
+void Library::watchFiles(const QStringList &paths)
+{
+    // files replaced by a rename are no longer watched: they are
+    // watched again once they are parsed
+    QSet<QString> watched = m_watcher->files().toSet();
+    QStringList files;
+    foreach (const QString &path, paths) {
+        if (!watched.contains(path))
+            files << path;
+    }
+    if (!files.isEmpty())
+        m_watcher->addPaths(files);
+}
+
+void Library::songsDirectoryModified(const QString &path)
+{
+    m_modifiedDirectories.insert(path);
+    m_watcherTimer->start();
+}
+
+void Library::songFileModified(const QString &path)
+{
+    // files edited in place do not modify their directory; the files
+    // of the directory are compared with the index
+    songsDirectoryModified(parentDirectory(path));
+}
+
+void Library::updateModifiedDirectories()
+{
+    // wait for the songs being loaded
+    if (isUpdating()) {
+        m_watcherTimer->start();
+        return;
+    }
+
+    QSet<QString> directories = m_modifiedDirectories;
+    m_modifiedDirectories.clear();
+
+    // songs whose file disappeared from a modified directory
+    QList<int> removedRows;
+    foreach (const QString &directory, directories) {
+        foreach (int row, m_directoryRows.value(directory)) {
+            if (!QFile::exists(m_songs.path(row)))
+                removedRows << row;
+        }
+    }
+    std::sort(removedRows.begin(), removedRows.end());
+
+    // new or modified files; new subdirectories are watched
+    // and their songs are added as well
+    QStringList filter = QStringList() << "*.sg";
+    QSet<QString> watchedDirectories = m_watcher->directories().toSet();
+    QHash<QString, QFileInfo> modifiedFiles;
+    QStringList paths;
+    foreach (const QString &directory, directories) {
+        QDir dir(directory);
+        if (!dir.exists())
+            continue;
+
+        foreach (const QString &subdirectory,
+                 dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            QString subpath = dir.absoluteFilePath(subdirectory);
+            if (watchedDirectories.contains(subpath))
+                continue;
+
+            watchDirectory(subpath);
+            QDirIterator it(subpath, filter, QDir::Files,
+                            QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                it.next();
+                paths << it.filePath();
+                modifiedFiles.insert(it.filePath(), it.fileInfo());
+            }
+        }
+
+        foreach (const QFileInfo &fileInfo,
+                 dir.entryInfoList(filter, QDir::Files)) {
+            if (containsSong(fileInfo.filePath()) && m_index.find(fileInfo, 0))
+                continue;
+            paths << fileInfo.filePath();
+            modifiedFiles.insert(fileInfo.filePath(), fileInfo);
+        }
+    }
+
+    if (paths.isEmpty() && removedRows.isEmpty())
+        return;
+
+    // update existing rows, then append new songs
+    QList<Song> songs =
+        QtConcurrent::blockingMapped(paths, Song::headerFromFile);
+    QList<Song> newSongs;
+    QStringList lyricsPaths;
+    foreach (const Song &song, songs) {
+        if (song.path.isEmpty())
+            continue;
+
+        m_index.insert(modifiedFiles.value(song.path), song);
+        lyricsPaths << song.path;
+        if (containsSong(song.path))
+            updateSong(getSongIndex(song.path), song);
+        else
+            newSongs << song;
+    }
+    appendSongs(newSongs);
+    m_lyricsIndex->update(lyricsPaths);
+    watchFiles(lyricsPaths);
+
+    // remove contiguous ranges of rows, starting from the end so that
+    // the remaining rows keep their position
+    int i = removedRows.size() - 1;
+    while (i >= 0) {
+        int last = removedRows[i];
+        int first = last;
+        while (i > 0 && removedRows[i - 1] == first - 1)
+            first = removedRows[--i];
+        --i;
+
+        for (int row = first; row <= last; ++row)
+            m_index.remove(m_songs.path(row));
+        removeSongs(first, last);
+    }
+
+    m_index.save();
+    showMessage(tr("Library updated: %1 songs modified, %2 songs removed.")
+                    .arg(songs.size())
+                    .arg(removedRows.size()));
 }
 
 int Library::rowCount(const QModelIndex &) const { return m_songs.size(); }
 
 int Library::columnCount(const QModelIndex &) const { return 7; }
 
-void Library::addSong(const Song &song, bool resetModel)
+void Library::addSong(const Song &song) { appendSongs(QList<Song>() << song); }
+
+void Library::addSongs(const QStringList &paths)
+{
+    appendSongs(parseSongs(paths));
+}
+
+void Library::appendSongs(const QList<Song> &songs)
 {
-    m_songs << song;
+    if (songs.isEmpty())
+        return;
 
-    if (resetModel) {
-        beginResetModel();
-        emit(wasModified());
-        endResetModel();
+    int first = m_songs.size();
+    beginInsertRows(QModelIndex(), first, first + songs.size() - 1);
+    foreach (const Song &song, songs) {
+        m_rows.insert(song.path, m_songs.size());
+        m_songs.append(song);
+        indexRow(m_songs.size() - 1);
     }
+    endInsertRows();
+
+    insertCompletions(first, m_songs.size() - 1);
 }
 
-void Library::addSongs(const QStringList &paths)
+void Library::updateSong(int row, const Song &song)
 {
-    beginResetModel();
-    Song song;
-    int songCount = 0;
-    // run through the library songs files
-    QStringListIterator filepath(paths);
-    while (filepath.hasNext()) {
-        progressBar()->setValue(++songCount);
-        loadSong(filepath.next(), &song);
-        addSong(song);
+    removeCompletions(row, row);
+    unindexRow(row);
+    m_rows.remove(m_songs.path(row));
+    m_rows.insert(song.path, row);
+    m_songs.replace(row, song);
+    indexRow(row);
+    insertCompletions(row, row);
+    emit(dataChanged(index(row, 0), index(row, columnCount() - 1)));
+}
+
+void Library::removeSongs(int first, int last)
+{
+    removeCompletions(first, last);
+
+    beginRemoveRows(QModelIndex(), first, last);
+    for (int row = first; row <= last; ++row) {
+        m_rows.remove(m_songs.path(row));
+        m_lyricsIndex->remove(m_songs.path(row));
+        unindexRow(row);
     }
-    emit(wasModified());
-    endResetModel();
+    m_songs.remove(first, last);
+
+    // the following songs moved up
+    for (int row = first; row < m_songs.size(); ++row)
+        m_rows[m_songs.path(row)] = row;
+    shiftRows(m_coverRows, first, last);
+    shiftRows(m_directoryRows, first, last);
+    endRemoveRows();
+}
+
+QList<Song> Library::parseSongs(const QStringList &paths)
+{
+    // parse the .sg files on a pool of worker threads
+    QFutureWatcher<Song> watcher;
+    connect(&watcher, SIGNAL(progressValueChanged(int)), progressBar(),
+            SLOT(setValue(int)));
+    connect(progressBar(), SIGNAL(canceled()), &watcher, SLOT(cancel()));
+
+    // keep the interface responsive (progress, cancel button)
+    // while the songs are parsed
+    QEventLoop loop;
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    watcher.setFuture(QtConcurrent::mapped(paths, Song::headerFromFile));
+    if (!watcher.isFinished())
+        loop.exec();
+
+    // songs parsed before a cancelation are kept
+    QFuture<Song> future = watcher.future();
+    QList<Song> songs;
+    for (int i = 0; i < paths.size(); ++i) {
+        if (future.isResultReadyAt(i))
+            songs << future.resultAt(i);
+    }
+    return songs;
+}
+
+void Library::addSong(const QString &path)
+{
+    addSong(Song::headerFromFile(path));
 }
 
-void Library::addSong(const QString &path) { m_songs << Song::fromFile(path); }
+bool Library::containsSong(const QString &path)
+{
+    return m_rows.contains(path);
+}
 
 void Library::removeSong(const QString &path)
 {
-    beginResetModel();
-    for (int i = 0; i < m_songs.size(); ++i) {
-        if (m_songs[i].path == path) {
-            m_songs.removeAt(i);
-            break;
-        }
-    }
-    emit(wasModified());
-    endResetModel();
+    int row = getSongIndex(path);
+    if (row != -1)
+        removeSongs(row, row);
 }
 
 Song Library::getSong(const QString &path) const
 {
-    for (int i = 0; i < m_songs.size(); ++i) {
-        if (m_songs[i].path == path)
-            return m_songs[i];
-    }
-    return Song();
+    int row = getSongIndex(path);
+    return (row != -1) ? m_songs.song(row) : Song();
 }
 
 int Library::getSongIndex(const QString &path) const
 {
-    for (int i = 0; i < m_songs.size(); ++i) {
-        if (m_songs[i].path == path)
-            return i;
-    }
-    return -1;
+    return m_rows.value(path, -1);
+}
+
+void Library::lyricsRead(const QString &path, const QStringList &words)
+{
+    m_index.setWords(path, words);
 }
 
+void Library::lyricsIndexBuilt() { m_index.save(); }
+
+const QString &Library::searchKey(int row) const
+{
+    return m_songs.searchKey(row);
+}
+
+const LibraryStore &Library::store() const { return m_songs; }
+
 void Library::loadSong(const QString &path, Song *song)
 {
     if (song == 0)
@@ -375,19 +861,15 @@ void Library::loadSong(const QString &path, Song *song)
 void Library::saveSong(Song &song)
 {
     // write the song file
-    QFile file(song.path);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream stream(&file);
-        stream.setCodec("UTF-8");
-        stream << Song::toString(song);
-        file.close();
-    }
+    m_writer->write(song);
+    m_lyricsIndex->insert(song.path, song.lyrics);
+
     // update the song in the library
-    int index = getSongIndex(song.path);
-    if (index != -1)
-        m_songs[index] = song;
+    int row = getSongIndex(song.path);
+    if (row != -1)
+        updateSong(row, songHeader(song));
     else // new song
-        addSong(song, true);
+        addSong(songHeader(song));
 }
 
 void Library::saveCover(Song &song, const QImage &cover)
@@ -415,12 +897,61 @@ void Library::saveCover(Song &song, const QImage &cover)
             QMessageBox::Cancel | QMessageBox::Ok, QMessageBox::Cancel);
         // actually write the image
         if (ret == QMessageBox::Ok)
-            cover.save(coverFilename);
+            m_writer->write(coverFilename, cover);
     } else {
-        cover.save(coverFilename);
+        m_writer->write(coverFilename, cover);
     }
 }
 
+void Library::coverWritten(const QString &path, bool success)
+{
+    if (!success || !path.endsWith(".jpg"))
+        return;
+
+    Thumbnailer::instance()->invalidate(path);
+    coverChanged(path);
+}
+
+void Library::coverChanged(const QString &path)
+{
+    QFileInfo file(path);
+    QHash<QString, QVector<int> >::const_iterator it = m_coverRows.constFind(
+        coverKey(file.absolutePath(), file.completeBaseName()));
+    if (it == m_coverRows.constEnd())
+        return;
+
+    // songs sharing a cover are usually contiguous
+    const QVector<int> &rows = it.value();
+    int first = 0;
+    for (int i = 1; i <= rows.size(); ++i) {
+        if (i < rows.size() && rows[i] == rows[i - 1] + 1)
+            continue;
+        emit(dataChanged(index(rows[first], 0),
+                         index(rows[i - 1], columnCount() - 1)));
+        first = i;
+    }
+}
+
+void Library::indexRow(int row)
+{
+    insertRow(m_directoryRows, parentDirectory(m_songs.path(row)), row);
+
+    const QString &coverName = m_songs.coverName(row);
+    if (!coverName.isEmpty())
+        insertRow(m_coverRows, coverKey(m_songs.coverPath(row), coverName),
+                  row);
+}
+
+void Library::unindexRow(int row)
+{
+    removeRow(m_directoryRows, parentDirectory(m_songs.path(row)), row);
+
+    const QString &coverName = m_songs.coverName(row);
+    if (!coverName.isEmpty())
+        removeRow(m_coverRows, coverKey(m_songs.coverPath(row), coverName),
+                  row);
+}
+
 void Library::importSongs(const QStringList &filenames)
 {
     showMessage(tr("Importing %1 songs within the library %2")
@@ -429,7 +960,7 @@ void Library::importSongs(const QStringList &filenames)
     Song song;
     QMap<QString, QString> sourceTargetMap;
     foreach (const QString &filename, filenames) {
-        song = Song::fromFile(filename);
+        song = Song::headerFromFile(filename);
         sourceTargetMap.insert(filename, pathToSong(song));
     }
 
@@ -474,7 +1005,7 @@ QString Library::pathToSong(const QString &artist, const QString &title) const
     QString titleInPath = stringToFilename(title, "_");
 
     return QString("%1/songs/%2/%3.sg")
-        .arg(directory().canonicalPath())
+        .arg(directory().absolutePath())
         .arg(artistInPath)
         .arg(titleInPath);
 }
@@ -495,7 +1026,23 @@ MainWindow *Library::parent() const { return m_parent; }
 
 void Library::setParent(MainWindow *parent) { m_parent = parent; }
 
-QString Library::checkPath(const QString &path)
+int Library::countSongs(const QString &path, const QAtomicInt *canceled)
+{
+    // walk the tree without building a QFileInfo list per directory;
+    // symbolic links to directories are not followed
+    QDirIterator it(path, QStringList() << "*.sg", QDir::Files,
+                    QDirIterator::Subdirectories);
+    int count = 0;
+    while (it.hasNext()) {
+        if (canceled && canceled->load())
+            return -1;
+        it.next();
+        ++count;
+    }
+    return count;
+}
+
+QString Library::checkPath(const QString &path, const QAtomicInt *canceled)
 {
     QDir directory(path);
 
@@ -511,10 +1058,10 @@ QString Library::checkPath(const QString &path)
     } else {
         error = false;
         // look for sg files
-        QStringList songs;
-        recursiveFindFiles(path, QStringList() << "*.sg", songs);
-        uint nbSongs = songs.count();
-        if (nbSongs > 0) {
+        int nbSongs = countSongs(path, canceled);
+        if (nbSongs < 0) {
+            return QString();
+        } else if (nbSongs > 0) {
             warning = false;
             message =
                 QString(tr("%1 songs found in this library")).arg(nbSongs);
@@ -21,16 +21,28 @@
 #define __LIBRARY_HH__
 
 #include "song.hh"
+#include "library-index.hh"
+#include "library-store.hh"
 #include "singleton.hh"
 
 #include <QAbstractTableModel>
 #include <QString>
 #include <QDir>
+#include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QFileInfo>
 #include <QLocale>
 #include <QMetaType>
+#include <QAtomicInt>
 
 class QAbstractListModel;
-class QStringListModel;
+class CompletionModel;
+class QFileSystemWatcher;
+class QTimer;
+class SongWriter;
+class LyricsIndex;
+template <typename T> class QFutureWatcher;
 
 class QPixmap;
 class ProgressBar;
@@ -42,7 +54,13 @@ class MainWindow;
   \brief Library is the base model that corresponds to the list of songs
 
   A Library is a list of Song objects (structure representing .sg
-  files) that are fetched from a local directory.
+  files) that are fetched from a local directory. The songs are kept
+  column by column in a LibraryStore.
+
+  The songs/ directory of the library is watched: when .sg files are
+  added, modified or removed by another application, the
+  corresponding rows are inserted, updated or removed without
+  resetting the model.
 
   This model is used to build an intermediate model
   (SongSortFilterProxyModel) that allows filtering options, and is
@@ -126,7 +144,9 @@ public:
     /*!
     Returns the completion model associated with the library.
     The completion model is based on the list of words from
-    title, artist and album columns.
+    title, artist and path columns.
+    The completion models are sorted case insensitively and are
+    updated along with the songs of the library.
     \sa artistCompletionModel, albumCompletionModel, urlCompletionModel
   */
     QAbstractListModel *completionModel() const;
@@ -149,6 +169,13 @@ public:
   */
     QAbstractListModel *urlCompletionModel() const;
 
+    /*!
+    Returns the inverted index of the lyrics of the songs.
+    It is built in the background once the library is loaded and
+    kept up to date as songs are saved, modified or removed.
+  */
+    LyricsIndex *lyricsIndex() const;
+
     /*!
     Reimplements QAbstractTableModel::headerData.
     \sa data
@@ -194,10 +221,9 @@ public:
 
     /*!
     Adds a the song \a song to the library.
-    If \a reset is \a true, the whole library is parsed again.
     \sa addSongs
   */
-    void addSong(const Song &song, bool reset = false);
+    void addSong(const Song &song);
 
     /*!
     A Song object is built from the file \a path
@@ -209,10 +235,18 @@ public:
     /*!
     Song objects are built from the files in \a paths
     and are added to the library.
+    Files are parsed concurrently and the rows are inserted once
+    every file has been parsed.
     \sa addSong
   */
     void addSongs(const QStringList &paths);
 
+    /*!
+    Returns \a true while the songs of the library are being loaded.
+    \sa update
+  */
+    bool isUpdating() const;
+
     void importSongs(const QStringList &filenames);
 
     /*!
@@ -233,14 +267,33 @@ public:
   */
     int getSongIndex(const QString &path) const;
 
+    /*!
+    Returns the search key of the song at position \a row: its title,
+    artist and album without case and diacritics.
+    \sa fold
+  */
+    const QString &searchKey(int row) const;
+
+    /*!
+    Returns the songs of the library. A copy of the store is cheap and
+    can be read from another thread while the library changes.
+    \sa FilterEngine
+  */
+    const LibraryStore &store() const;
+
     /*!
     Returns the Song object whose path is \a path from the library.
-    \sa getSongIndex
+    Only the header of the song is available: use loadSong to get
+    its chords and lyrics.
+    \sa getSongIndex, loadSong
   */
     Song getSong(const QString &path) const;
 
     /*!
-    Loads a Song object in the library from the file \a path.
+    Loads the complete Song object (with its chords and lyrics) from
+    the file \a path, whereas the library only holds the header of
+    the songs.
+    \sa getSong
   */
     void loadSong(const QString &path, Song *song);
 
@@ -251,6 +304,8 @@ public:
 
     /*!
     Saves the song \a song in the library (update the song path if required).
+    The library is updated at once whereas the file is written in the
+    background; the written() signal is emitted once it is done.
     \sa saveCover
   */
     void saveSong(Song &song);
@@ -258,6 +313,7 @@ public:
     /*!
     Saves the cover \a cover in the library directory (update the cover path if
     required).
+    The image is written in the background.
     \sa saveSong
   */
     void saveCover(Song &song, const QImage &cover);
@@ -267,7 +323,23 @@ public:
   */
     void deleteSong(const QString &path);
 
-    static QString checkPath(const QString &path);
+    /*!
+    Returns the number of .sg files found in \a path and its
+    subdirectories, or -1 if \a canceled was set during the walk.
+    \sa checkPath
+  */
+    static int countSongs(const QString &path,
+                          const QAtomicInt *canceled = 0);
+
+    /*!
+    Returns a rich text message describing whether \a path is a valid
+    library, or an empty string if \a canceled was set while counting
+    the songs.
+    This function is thread-safe.
+    \sa LibraryPathChecker
+  */
+    static QString checkPath(const QString &path,
+                             const QAtomicInt *canceled = 0);
 
     static void recursiveFindFiles(const QString &path,
                                    const QStringList &filters,
@@ -281,6 +353,14 @@ public:
 
 public slots:
     void readSettings();
+
+    /*!
+    Reloads the songs of the library.
+    Songs from the index are available immediately; the other files
+    are parsed in the background and their rows are inserted by
+    batches so that the library can be used during the update.
+    \sa isUpdating, updated
+  */
     void update();
 
 signals:
@@ -288,20 +368,183 @@ signals:
     void directoryChanged(const QDir &directory);
     void noDirectory();
 
-protected:
+    /*!
+    This signal is emitted when every song of the library \a directory
+    has been loaded.
+    \sa update
+  */
+    void updated(const QDir &directory);
+
+    /*!
+    This signal is emitted when a song or a cover has been written to
+    \a path; \a success is false if the file could not be written.
+    \sa saveSong, saveCover
+  */
+    void written(const QString &path, bool success);
+
+private slots:
+    /*!
+    Schedules the update of the songs from the directory \a path.
+    Bursts of modifications are gathered before the library is updated.
+    \sa updateModifiedDirectories
+  */
+    void songsDirectoryModified(const QString &path);
+
+    /*!
+    Schedules the update of the song file \a path, which was modified
+    without its directory being modified (such as a file edited in
+    place).
+    \sa songsDirectoryModified
+  */
+    void songFileModified(const QString &path);
+
+    /*!
+    Applies the changes of the .sg files from the modified directories
+    as row insertions, row removals and data changes.
+    \sa songsDirectoryModified
+  */
+    void updateModifiedDirectories();
+
+    /*!
+    Buffers the songs parsed in the background between
+    positions \a begin and \a end.
+    \sa insertParsedSongs
+  */
+    void songsParsed(int begin, int end);
+
+    /*!
+    Stores the \a words of the lyrics of the song \a path in the
+    index.
+    \sa lyricsIndexBuilt
+  */
+    void lyricsRead(const QString &path, const QStringList &words);
+
+    /*!
+    Saves the index once the lyrics have been read.
+    \sa lyricsRead
+  */
+    void lyricsIndexBuilt();
+
+    /*!
+    Refreshes the songs using the cover \a path once it is written.
+    \sa saveCover
+  */
+    void coverWritten(const QString &path, bool success);
+
+    /*!
+    Notifies the views that the cover \a path of some songs changed.
+    Only the rows of the songs using this cover are updated; they are
+    kept by cover as the songs are added, replaced and removed.
+  */
+    void coverChanged(const QString &path);
+
+    /*!
+    Appends the buffered parsed songs to the library. Songs that are
+    already in the library, such as songs saved during the update,
+    are replaced instead.
+    \sa songsParsed
+  */
+    void insertParsedSongs();
+
+    /*!
+    Completes the update once every song has been parsed.
+    \sa update
+  */
+    void parsingFinished();
+
 private:
     MainWindow *m_parent;
     bool checkSongbookPath(const QString &path);
 
+    /*!
+    Watches the directory \a path and its subdirectories.
+  */
+    void watchDirectory(const QString &path);
+
+    /*!
+    Watches the song files \a paths, so that files edited in place
+    are updated as well.
+  */
+    void watchFiles(const QStringList &paths);
+
+    /*!
+    Adds the songs from position \a first to position \a last to the
+    completion models.
+    \sa removeCompletions
+  */
+    void insertCompletions(int first, int last);
+
+    /*!
+    Removes the songs from position \a first to position \a last from
+    the completion models.
+    \sa insertCompletions
+  */
+    void removeCompletions(int first, int last);
+
+    /*!
+    Builds Song objects from the files in \a paths using every
+    available core. Progress is reported in the progress bar and the
+    parsing can be canceled from it; songs parsed before the
+    cancelation are returned.
+  */
+    QList<Song> parseSongs(const QStringList &paths);
+
+    /*!
+    Appends \a songs to the library.
+    \sa removeSongs
+  */
+    void appendSongs(const QList<Song> &songs);
+
+    /*!
+    Replaces the song at position \a row by \a song.
+  */
+    void updateSong(int row, const Song &song);
+
+    /*!
+    Removes the songs from position \a first to position \a last.
+    \sa appendSongs
+  */
+    void removeSongs(int first, int last);
+
+    /*!
+    Adds the song at position \a row to the songs of its directory
+    and of its cover.
+    \sa unindexRow, coverChanged, updateModifiedDirectories
+  */
+    void indexRow(int row);
+
+    /*!
+    Removes the song at position \a row from the songs of its
+    directory and of its cover.
+    \sa indexRow
+  */
+    void unindexRow(int row);
+
     QDir m_directory;
 
-    QStringListModel *m_completionModel;
-    QStringListModel *m_artistCompletionModel;
-    QStringListModel *m_albumCompletionModel;
-    QStringListModel *m_urlCompletionModel;
+    CompletionModel *m_completionModel;
+    CompletionModel *m_artistCompletionModel;
+    CompletionModel *m_albumCompletionModel;
+    CompletionModel *m_urlCompletionModel;
 
     QStringList m_templates;
-    QList<Song> m_songs;
+    LibraryStore m_songs;
+    QHash<QString, int> m_rows;
+    QHash<QString, QVector<int> > m_coverRows;
+    QHash<QString, QVector<int> > m_directoryRows;
+    LibraryIndex m_index;
+
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_watcherTimer;
+    QSet<QString> m_modifiedDirectories;
+
+    QFutureWatcher<Song> *m_parseWatcher;
+    QTimer *m_flushTimer;
+    QList<Song> m_parsedSongs;
+    QHash<QString, QFileInfo> m_parsedFiles;
+
+    SongWriter *m_writer;
+    LyricsIndex *m_lyricsIndex;
 };
 
 Q_DECLARE_METATYPE(QLocale::Language)
@@ -0,0 +1,288 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "lyrics-index.hh"
+
+#include "song.hh"
+#include "text-folding.hh"
+
+#include <QPair>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+const int LyricsIndex::_minimumPrefixLength = 3;
+
+LyricsIndex::LyricsIndex(QObject *parent)
+    : QObject(parent)
+    , m_words()
+    , m_postings()
+    , m_documents()
+    , m_paths()
+    , m_documentWords()
+    , m_queue()
+    , m_watcher(new QFutureWatcher<Document>(this))
+    , m_changedTimer(new QTimer(this))
+{
+    connect(m_watcher, SIGNAL(resultsReadyAt(int, int)),
+            SLOT(documentsRead(int, int)));
+    connect(m_watcher, SIGNAL(finished()), SLOT(readingFinished()));
+
+    // views are refreshed at most every 300 ms while reading files
+    m_changedTimer->setSingleShot(true);
+    m_changedTimer->setInterval(300);
+    connect(m_changedTimer, SIGNAL(timeout()), SIGNAL(changed()));
+}
+
+LyricsIndex::~LyricsIndex()
+{
+    m_watcher->cancel();
+    m_watcher->waitForFinished();
+}
+
+void LyricsIndex::build(const QStringList &paths)
+{
+    m_watcher->cancel();
+    m_watcher->waitForFinished();
+    clear();
+    m_queue = paths;
+    readQueuedDocuments();
+}
+
+void LyricsIndex::update(const QStringList &paths)
+{
+    m_queue << paths;
+    if (!m_watcher->isRunning())
+        readQueuedDocuments();
+}
+
+bool LyricsIndex::isBuilding() const { return m_watcher->isRunning(); }
+
+void LyricsIndex::readQueuedDocuments()
+{
+    if (m_queue.isEmpty())
+        return;
+
+    QStringList paths;
+    paths.swap(m_queue);
+    m_watcher->setFuture(QtConcurrent::mapped(paths, readDocument));
+}
+
+LyricsIndex::Document LyricsIndex::readDocument(const QString &path)
+{
+    Document document;
+    document.path = path;
+    document.words = words(Song::fromFile(path).lyrics);
+    return document;
+}
+
+void LyricsIndex::documentsRead(int begin, int end)
+{
+    for (int i = begin; i < end; ++i) {
+        Document document = m_watcher->resultAt(i);
+        insertWords(document.path, document.words);
+        emit(documentRead(document.path, document.words));
+    }
+    scheduleChanged();
+}
+
+void LyricsIndex::readingFinished()
+{
+    readQueuedDocuments();
+    scheduleChanged();
+    if (!m_watcher->isRunning())
+        emit(built());
+}
+
+void LyricsIndex::scheduleChanged()
+{
+    if (!m_changedTimer->isActive())
+        m_changedTimer->start();
+}
+
+void LyricsIndex::insert(const QString &path, const QStringList &lyrics)
+{
+    insertWords(path, words(lyrics));
+}
+
+void LyricsIndex::insertWords(const QString &path, const QStringList &words)
+{
+    int document = m_documents.value(path, -1);
+    if (document == -1) {
+        document = m_paths.size();
+        m_documents.insert(path, document);
+        m_paths << path;
+        m_documentWords << QVector<int>();
+    } else {
+        removeWords(document);
+    }
+
+    QVector<int> ids;
+    ids.reserve(words.size());
+    foreach (const QString &word, words) {
+        QMap<QString, int>::iterator it = m_words.find(word);
+        if (it == m_words.end()) {
+            it = m_words.insert(word, m_postings.size());
+            m_postings << QVector<int>();
+        }
+
+        // documents are mostly indexed in increasing order
+        QVector<int> &postings = m_postings[it.value()];
+        if (postings.isEmpty() || postings.last() < document)
+            postings.append(document);
+        else
+            postings.insert(std::lower_bound(postings.begin(),
+                                             postings.end(), document) -
+                                postings.begin(),
+                            document);
+        ids << it.value();
+    }
+    m_documentWords[document] = ids;
+    scheduleChanged();
+}
+
+void LyricsIndex::removeWords(int document)
+{
+    foreach (int id, m_documentWords[document]) {
+        QVector<int> &postings = m_postings[id];
+        QVector<int>::iterator it =
+            std::lower_bound(postings.begin(), postings.end(), document);
+        if (it != postings.end() && *it == document)
+            postings.erase(it);
+    }
+    m_documentWords[document].clear();
+}
+
+void LyricsIndex::remove(const QString &path)
+{
+    int document = m_documents.value(path, -1);
+    if (document == -1)
+        return;
+
+    removeWords(document);
+    m_documents.remove(path);
+    m_paths[document].clear();
+    scheduleChanged();
+}
+
+void LyricsIndex::clear()
+{
+    m_words.clear();
+    m_postings.clear();
+    m_documents.clear();
+    m_paths.clear();
+    m_documentWords.clear();
+    scheduleChanged();
+}
+
+QSet<QString> LyricsIndex::find(const QString &query) const
+{
+    QSet<QString> paths;
+    QStringList queryWords = foldedWords(query);
+    if (queryWords.isEmpty())
+        return paths;
+
+    // postings of the words matching each query word; short words
+    // would match too many words as prefixes
+    QVector<QVector<const QVector<int> *> > matches;
+    QVector<QPair<int, int> > order;
+    for (int i = 0; i < queryWords.size(); ++i) {
+        const QString &word = queryWords[i];
+        QVector<const QVector<int> *> postings;
+        int count = 0;
+        QMap<QString, int>::const_iterator it = m_words.lowerBound(word);
+        for (; it != m_words.constEnd() && it.key().startsWith(word); ++it) {
+            if (word.size() < _minimumPrefixLength && it.key() != word)
+                break;
+            if (m_postings[it.value()].isEmpty())
+                continue;
+            postings << &m_postings[it.value()];
+            count += m_postings[it.value()].size();
+        }
+        if (postings.isEmpty())
+            return paths;
+
+        matches << postings;
+        order << qMakePair(count, i);
+    }
+
+    // the documents of the least frequent word are checked against
+    // the postings of the other words
+    std::sort(order.begin(), order.end());
+    QVector<int> result;
+    foreach (const QVector<int> *postings, matches[order[0].second])
+        result += *postings;
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    for (int i = 1; i < order.size() && !result.isEmpty(); ++i) {
+        const QVector<const QVector<int> *> &postings =
+            matches[order[i].second];
+        QVector<int> common;
+        foreach (int document, result) {
+            foreach (const QVector<int> *documents, postings) {
+                if (std::binary_search(documents->constBegin(),
+                                       documents->constEnd(), document)) {
+                    common << document;
+                    break;
+                }
+            }
+        }
+        result.swap(common);
+    }
+
+    paths.reserve(result.size());
+    foreach (int document, result)
+        paths.insert(m_paths[document]);
+    return paths;
+}
+
+QStringList LyricsIndex::words(const QStringList &lyrics)
+{
+    QSet<QString> words;
+    foreach (const QString &line, lyrics) {
+        QString text = Song::latexToUtf8(line);
+
+        // drop chords (\[C]) and macro names (\echo), chords may be
+        // in the middle of a word
+        QString plain;
+        plain.reserve(text.size());
+        const QChar *c = text.constData();
+        const QChar *end = c + text.size();
+        while (c != end) {
+            if (*c != QLatin1Char('\\')) {
+                plain.append(*c++);
+            } else if (++c != end && *c == QLatin1Char('[')) {
+                while (c != end && *c != QLatin1Char(']'))
+                    ++c;
+                if (c != end)
+                    ++c;
+            } else {
+                while (c != end && c->isLetter())
+                    ++c;
+                plain.append(QLatin1Char(' '));
+            }
+        }
+
+        foreach (const QString &word, foldedWords(plain))
+            words.insert(word);
+    }
+    return words.toList();
+}
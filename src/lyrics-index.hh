@@ -0,0 +1,175 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __LYRICS_INDEX_HH__
+#define __LYRICS_INDEX_HH__
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+class QTimer;
+template <typename T> class QFutureWatcher;
+
+/*!
+  \file lyrics-index.hh
+  \class LyricsIndex
+  \brief LyricsIndex is an inverted index of the words of the lyrics
+
+  The library only keeps the header of the songs; LyricsIndex reads
+  the lyrics of the .sg files in the background and associates each
+  folded word (see text-folding.hh) with the sorted list of the songs
+  that contain it. Chords and LaTeX macros are not indexed.
+
+  Words are kept sorted, so that find() also matches the words that
+  start with the words of the query, without scanning any lyrics.
+
+  The words read from each file are reported with documentRead(), so
+  that they can be stored and indexed again with insertWords() without
+  reading the file.
+
+  \sa Library::lyricsIndex, SongSortFilterProxyModel
+*/
+class LyricsIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    LyricsIndex(QObject *parent = 0);
+
+    /// Destructor.
+    ~LyricsIndex();
+
+    /*!
+    Replaces the contents of the index with the lyrics of the files
+    \a paths, which are read in the background.
+    \sa update, isBuilding
+  */
+    void build(const QStringList &paths);
+
+    /*!
+    Reads the lyrics of the files \a paths in the background and
+    updates their entries.
+    \sa build, insert
+  */
+    void update(const QStringList &paths);
+
+    /*!
+    Returns \a true while files are being read.
+  */
+    bool isBuilding() const;
+
+    /*!
+    Indexes \a lyrics as the lyrics of the song \a path,
+    replacing its previous entry.
+    \sa remove
+  */
+    void insert(const QString &path, const QStringList &lyrics);
+
+    /*!
+    Indexes the folded \a words, as returned by words(), as the words
+    of the lyrics of the song \a path, replacing its previous entry.
+    \sa insert, documentRead
+  */
+    void insertWords(const QString &path, const QStringList &words);
+
+    /*!
+    Removes the entry of the song \a path.
+    \sa insert
+  */
+    void remove(const QString &path);
+
+    /*!
+    Removes all entries.
+  */
+    void clear();
+
+    /*!
+    Returns the paths of the songs whose lyrics contain every word of
+    \a query, either as a word or as the beginning of a word. Words of
+    the query shorter than 3 characters only match whole words.
+    Case and diacritics are ignored.
+  */
+    QSet<QString> find(const QString &query) const;
+
+    /*!
+    Returns the distinct folded words of \a lyrics, without chords
+    and LaTeX macros.
+  */
+    static QStringList words(const QStringList &lyrics);
+
+signals:
+    /*!
+    This signal is emitted when entries have been inserted or removed.
+    Changes made by the background reading are grouped.
+  */
+    void changed();
+
+    /*!
+    This signal is emitted when the lyrics of the file \a path have
+    been read in the background; \a words are their folded words.
+    \sa insertWords
+  */
+    void documentRead(const QString &path, const QStringList &words);
+
+    /*!
+    This signal is emitted when every file queued by build() or
+    update() has been read.
+  */
+    void built();
+
+private slots:
+    void documentsRead(int begin, int end);
+    void readingFinished();
+
+private:
+    struct Document
+    {
+        QString path;
+        QStringList words;
+    };
+
+    static Document readDocument(const QString &path);
+
+    /*!
+    Length under which the words of a query are not matched as the
+    beginning of longer words.
+  */
+    static const int _minimumPrefixLength;
+
+    void removeWords(int document);
+    void readQueuedDocuments();
+    void scheduleChanged();
+
+    QMap<QString, int> m_words;
+    QVector<QVector<int> > m_postings;
+    QHash<QString, int> m_documents;
+    QVector<QString> m_paths;
+    QVector<QVector<int> > m_documentWords;
+
+    QStringList m_queue;
+    QFutureWatcher<Document> *m_watcher;
+    QTimer *m_changedTimer;
+};
+
+#endif // __LYRICS_INDEX_HH__
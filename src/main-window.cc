@@ -43,6 +43,7 @@
 
 #include "label.hh"
 #include "library.hh"
+#include "image-cache.hh"
 #include "library-view.hh"
 #include "songbook.hh"
 #include "song-editor.hh"
@@ -220,7 +221,7 @@ MainWindow::MainWindow(QWidget *parent)
     setWindowIcon(QIcon(":/icons/songbook/256x256/patagui.png"));
     Library::instance()->setParent(this);
 
-    connect(library(), SIGNAL(directoryChanged(const QDir &)),
+    connect(library(), SIGNAL(updated(const QDir &)),
             SLOT(noDataNotification(const QDir &)));
     connect(library(), SIGNAL(noDirectory()),
             SLOT(noSongbookDirectoryNotification()));
@@ -229,7 +230,7 @@ MainWindow::MainWindow(QWidget *parent)
             SLOT(setWindowModified(bool)));
     connect(
         m_songbook,
-        SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+        SIGNAL(checkStateChanged(const QModelIndex &, const QModelIndex &)),
         SLOT(selectedSongsChanged(const QModelIndex &, const QModelIndex &)));
 
     // proxy model (sorting & filtering)
@@ -286,8 +287,20 @@ MainWindow::MainWindow(QWidget *parent)
     //            this, SLOT(buildError(QProcess::ProcessError)));
     updateTitle(songbook()->filename());
 
-    // make a clean cache directory for the application
-    removeDirectoryRecursively(QDir(_cachePath));
+    // make a clean cache directory for the application, but keep the
+    // cover thumbnails from the previous sessions
+    QDir cacheDirectory(_cachePath);
+    QFileInfoList entries = cacheDirectory.entryInfoList(
+        QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks | QDir::Dirs |
+        QDir::Files);
+    foreach (const QFileInfo &entry, entries) {
+        if (entry.fileName() == "thumbnails")
+            continue;
+        if (entry.isDir())
+            removeDirectoryRecursively(QDir(entry.absoluteFilePath()));
+        else
+            QFile::remove(entry.absoluteFilePath());
+    }
     QDir().mkpath(_cachePath);
 
     readSettings(true);
@@ -438,6 +451,12 @@ void MainWindow::createActions()
     m_bugsAct->setStatusTip(tr("Report a bug about this application"));
     connect(m_bugsAct, SIGNAL(triggered()), this, SLOT(reportBug()));
 
+    m_imageCacheAct = new QAction(tr("&Image cache statistics"), this);
+    m_imageCacheAct->setStatusTip(
+        tr("Show the memory used by the cached covers, chords and icons"));
+    connect(m_imageCacheAct, SIGNAL(triggered()), this,
+            SLOT(imageCacheStatistics()));
+
     m_aboutAct = new QAction(tr("&About"), this);
     m_aboutAct->setIcon(QIcon::fromTheme(
         "help-about", QIcon(":/icons/tango/32x32/actions/help-about.png")));
@@ -566,6 +585,7 @@ void MainWindow::createMenus()
     QMenu *helpMenu = menuBar()->addMenu(tr("&Help"));
     helpMenu->addAction(m_documentationAct);
     helpMenu->addAction(m_bugsAct);
+    helpMenu->addAction(m_imageCacheAct);
     helpMenu->addAction(m_aboutAct);
 }
 
@@ -581,6 +601,7 @@ void MainWindow::createToolBar()
     QCompleter *completer = new QCompleter;
     completer->setModel(library()->completionModel());
     completer->setCaseSensitivity(Qt::CaseInsensitive);
+    completer->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
     completer->setCompletionMode(QCompleter::PopupCompletion);
 
     m_filterLineEdit = new FilterLineEdit;
@@ -631,6 +652,36 @@ void MainWindow::reportBug()
         QUrl("https://github.com/patacrep/patagui/issues"));
 }
 
+void MainWindow::imageCacheStatistics()
+{
+    QString rows;
+    QString row("<tr><td>%1</td><td align=right>%2</td><td align=right>%3</td>"
+                "<td align=right>%4</td><td align=right>%5</td>"
+                "<td align=right>%6 / %7 KiB</td></tr>");
+    for (int i = 0; i < ImageCache::CategoryCount; ++i) {
+        ImageCache::Category category = ImageCache::Category(i);
+        ImageCache::Statistics statistics =
+            ImageCache::instance()->statistics(category);
+        qint64 lookups = statistics.hits + statistics.misses;
+        rows += row.arg(ImageCache::categoryName(category))
+                    .arg(statistics.count)
+                    .arg(statistics.hits)
+                    .arg(statistics.misses)
+                    .arg(statistics.evictions)
+                    .arg(statistics.bytes / 1024)
+                    .arg(statistics.budget / 1024);
+        if (lookups > 0)
+            rows += tr("<tr><td></td><td colspan=6>hit rate: %1%</td></tr>")
+                        .arg(100.0 * statistics.hits / lookups, 0, 'f', 1);
+    }
+
+    QMessageBox::information(
+        this, tr("Image cache statistics"),
+        tr("<table cellspacing=4><tr><th></th><th>Images</th><th>Hits</th>"
+           "<th>Misses</th><th>Evictions</th><th>Memory</th></tr>%1</table>")
+            .arg(rows));
+}
+
 void MainWindow::about()
 {
     QString title(tr("About Patagui"));
@@ -838,7 +889,10 @@ void MainWindow::songEditor(const QString &path)
         if (library()->getSongIndex(path) == -1)
             library()->addSongs(QStringList() << path);
 
-        editor->setSong(library()->getSong(path));
+        // the library only holds song headers: load the lyrics
+        Song song;
+        library()->loadSong(path, &song);
+        editor->setSong(song);
     }
 
     // create the corresponding tab
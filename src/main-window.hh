@@ -172,6 +172,7 @@ private slots:
     void setStatusBarDisplayed(bool);
     void documentation();
     void reportBug();
+    void imageCacheStatistics();
     void about();
 
     void updateTitle(const QString &filename);
@@ -226,6 +227,7 @@ private:
     QAction *m_preferencesAct;
     QAction *m_documentationAct;
     QAction *m_bugsAct;
+    QAction *m_imageCacheAct;
     QAction *m_aboutAct;
     QAction *m_exitAct;
 
@@ -43,6 +43,7 @@
 #include "main-window.hh"
 #include "songbook.hh"
 #include "library.hh"
+#include "library-path-checker.hh"
 #include "file-chooser.hh"
 
 #include <QDebug>
@@ -273,6 +274,7 @@ OptionsPage::OptionsPage(QWidget *parent)
     , m_songbookPathValid(new QLabel)
     , m_libraryPath(0)
     , m_libraryPathValid(new QLabel)
+    , m_libraryPathChecker(new LibraryPathChecker(this))
     , m_buildCommand(0)
     , m_cleanCommand(0)
     , m_cleanallCommand(0)
@@ -292,6 +294,8 @@ OptionsPage::OptionsPage(QWidget *parent)
 
     connect(m_libraryPath, SIGNAL(pathChanged(const QString &)), this,
             SLOT(checkLibraryPath(const QString &)));
+    connect(m_libraryPathChecker, SIGNAL(checked(const QString &)),
+            m_libraryPathValid, SLOT(setText(const QString &)));
 
     readSettings();
 
@@ -370,7 +374,7 @@ void OptionsPage::checkSongbookPath(const QString &path)
 
 void OptionsPage::checkLibraryPath(const QString &path)
 {
-    m_libraryPathValid->setText(Library::checkPath(path));
+    m_libraryPathChecker->check(path);
 }
 
 // Editor Page
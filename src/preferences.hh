@@ -35,6 +35,7 @@ class QLineEdit;
 class QCheckBox;
 class QSpinBox;
 class FileChooser;
+class LibraryPathChecker;
 class MainWindow;
 
 class QtGroupBoxPropertyBrowser;
@@ -162,6 +163,7 @@ private:
 
     FileChooser *m_libraryPath;
     QLabel *m_libraryPathValid;
+    LibraryPathChecker *m_libraryPathChecker;
 
     QLineEdit *m_buildCommand;
     QLineEdit *m_cleanCommand;
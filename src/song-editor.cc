@@ -204,6 +204,8 @@ SongEditor::SongEditor(QWidget *parent)
 
     // connects
     connect(m_saveAct, SIGNAL(triggered()), SLOT(save()));
+    connect(library(), SIGNAL(written(const QString &, bool)),
+            SLOT(songWritten(const QString &, bool)));
     connect(m_cutAct, SIGNAL(triggered()), codeEditor(), SLOT(cut()));
     connect(m_copyAct, SIGNAL(triggered()), codeEditor(), SLOT(copy()));
     connect(m_pasteAct, SIGNAL(triggered()), codeEditor(), SLOT(paste()));
@@ -292,7 +294,21 @@ void SongEditor::save()
     setModified(false);
     setWindowTitle(m_song.title);
     emit(labelChanged(windowTitle()));
-    setStatusTip(tr("Song saved in: %1").arg(song().path));
+    setStatusTip(tr("Saving song in: %1").arg(song().path));
+}
+
+void SongEditor::songWritten(const QString &path, bool success)
+{
+    if (path != song().path)
+        return;
+
+    if (success) {
+        setStatusTip(tr("Song saved in: %1").arg(path));
+        emit(saved(path));
+    } else {
+        setStatusTip(tr("Unable to save song in: %1").arg(path));
+        setModified(true);
+    }
 }
 
 bool SongEditor::checkSongMandatoryFields()
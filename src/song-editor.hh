@@ -183,6 +183,7 @@ protected:
 private slots:
     // write modifications of the textEdit into sg file.
     void save();
+    void songWritten(const QString &path, bool success);
     void documentWasModified();
     void findReplaceDialog();
 
@@ -23,6 +23,8 @@
 #include "chord.hh"
 #include "diagram-area.hh"
 #include "library.hh"
+#include "thumbnail-cache.hh"
+#include "image-cache.hh"
 
 #include "utils/lineedit.hh"
 
@@ -36,7 +38,6 @@
 
 #include <QFileInfo>
 #include <QFile>
-#include <QPixmapCache>
 #include <QPixmap>
 #include <QFileDialog>
 #include <QCompleter>
@@ -281,16 +282,19 @@ void CSongHeaderEditor::setLibraryCompleters()
     QCompleter *completer = new QCompleter;
     completer->setModel(library->artistCompletionModel());
     completer->setCaseSensitivity(Qt::CaseInsensitive);
+    completer->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
     m_artistLineEdit->setCompleter(completer);
 
     completer = new QCompleter;
     completer->setModel(library->albumCompletionModel());
     completer->setCaseSensitivity(Qt::CaseInsensitive);
+    completer->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
     m_albumLineEdit->setCompleter(completer);
 
     completer = new QCompleter;
     completer->setModel(library->urlCompletionModel());
     completer->setCaseSensitivity(Qt::CaseInsensitive);
+    completer->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
     m_urlLineEdit->setCompleter(completer);
 }
 
@@ -507,21 +511,18 @@ void CoverDropArea::update()
     {
         song().coverPath = file.absolutePath();
         song().coverName = file.baseName();
-        if (!QPixmapCache::find(file.baseName()+"-full", &pixmap))
-        {
-            setCover(file.filePath());
-            pixmap = QPixmap::fromImage(cover());
-            QPixmapCache::insert(file.baseName()+"-full", pixmap);
-        }
+        setCover(ThumbnailCache::instance()->thumbnail(file.filePath(),
+                                                       QSize(128, 0)));
+        pixmap = QPixmap::fromImage(cover());
     }
     else
     {
         song().coverPath = QString();
         song().coverName = QString();
-        if (!QPixmapCache::find("cover-missing-full", &pixmap))
+        if (!ImageCache::instance()->find(ImageCache::Covers, "cover-missing-115", &pixmap))
         {
             pixmap = QIcon::fromTheme("image-missing", QIcon(":/icons/tango/128x128/status/image-missing.png")).pixmap(115, 115);
-            QPixmapCache::insert("cover-missing-full", pixmap);
+            ImageCache::instance()->insert(ImageCache::Covers, "cover-missing-115", pixmap);
         }
     }
     setPixmap(pixmap);
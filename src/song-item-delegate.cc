@@ -19,12 +19,12 @@
 #include "song-item-delegate.hh"
 
 #include "library.hh"
+#include "image-cache.hh"
 
 #include <QApplication>
 #include <QStyle>
 #include <QPainter>
 #include <QLocale>
-#include <QPixmapCache>
 
 #include <QDebug>
 
@@ -44,6 +44,7 @@ void SongItemDelegate::paint(QPainter *painter,
     opt.state &= ~QStyle::State_HasFocus;
 
     QPalette::ColorRole textColor = QPalette::NoRole;
+    ImageCache *cache = ImageCache::instance();
     opt.state &= ~QStyle::State_HasFocus;
     if (opt.state & QStyle::State_Selected) {
         if (opt.state & QStyle::State_Active) {
@@ -60,12 +61,12 @@ void SongItemDelegate::paint(QPainter *painter,
     case 2: {
         if (index.model()->data(index, Library::LilypondRole).toBool()) {
             QPixmap pixmap;
-            if (!QPixmapCache::find("lilypond-checked", &pixmap)) {
+            if (!cache->find(ImageCache::Icons, "lilypond-checked", &pixmap)) {
                 pixmap = QIcon::fromTheme("audio-x-generic",
                                           QIcon(":/icons/tango/22x22/mimetypes/"
                                                 "audio-x-generic.png"))
                              .pixmap(22, 22);
-                QPixmapCache::insert("lilypond-checked", pixmap);
+                cache->insert(ImageCache::Icons, "lilypond-checked", pixmap);
             }
             QApplication::style()->drawItemPixmap(painter, opt.rect,
                                                   Qt::AlignCenter, pixmap);
@@ -74,11 +75,11 @@ void SongItemDelegate::paint(QPainter *painter,
     case 3: {
         if (index.model()->data(index, Library::WebsiteRole).toBool()) {
             QPixmap pixmap;
-            if (!QPixmapCache::find("website", &pixmap)) {
+            if (!cache->find(ImageCache::Icons, "website", &pixmap)) {
                 pixmap =
                     QIcon(":/icons/songbook/22x22/applications-internet.png")
                         .pixmap(22, 22);
-                QPixmapCache::insert("website", pixmap);
+                cache->insert(ImageCache::Icons, "website", pixmap);
             }
             QApplication::style()->drawItemPixmap(painter, opt.rect,
                                                   Qt::AlignCenter, pixmap);
@@ -87,12 +88,12 @@ void SongItemDelegate::paint(QPainter *painter,
     case 5: {
         // draw the cover
         QPixmap pixmap;
-        if (!QPixmapCache::find("cover-missing-small", &pixmap)) {
+        if (!cache->find(ImageCache::Covers, "cover-missing-22", &pixmap)) {
             pixmap = QIcon::fromTheme(
                          "image-missing",
                          QIcon(":/icons/tango/22x22/status/image-missing.png"))
                          .pixmap(22, 22);
-            QPixmapCache::insert("cover-missing-small", pixmap);
+            cache->insert(ImageCache::Covers, "cover-missing-22", pixmap);
         }
         if (index.model()
                 ->data(index, Library::CoverSmallRole)
@@ -121,14 +122,14 @@ void SongItemDelegate::paint(QPainter *painter,
                                      .value<QLocale::Language>();
         QString locale = QLocale(lang).name();
         QPixmap pixmap;
-        if (!QPixmapCache::find(locale, &pixmap)) {
+        if (!cache->find(ImageCache::Icons, "flag-" + locale, &pixmap)) {
             pixmap =
                 QIcon::fromTheme(
                     QString("flag-%1").arg(locale.split('_').first()),
                     QIcon(QString(":/icons/songbook/22x22/flags/flag-%1.png")
                               .arg(locale.split('_').first())))
                     .pixmap(22, 22);
-            QPixmapCache::insert(locale, pixmap);
+            cache->insert(ImageCache::Icons, "flag-" + locale, pixmap);
         }
         QApplication::style()->drawItemPixmap(painter, opt.rect,
                                               Qt::AlignCenter, pixmap);
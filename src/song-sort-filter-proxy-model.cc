@@ -20,208 +20,275 @@
 
 #include "library.hh"
 #include "songbook.hh"
+#include "lyrics-index.hh"
+#include "filter-engine.hh"
 
 #include <QDebug>
 
 SongSortFilterProxyModel::SongSortFilterProxyModel(QObject *parent)
     : QSortFilterProxyModel(parent)
-    , m_onlySelected(false)
-    , m_onlyNotSelected(false)
     , m_filterString()
-    , m_languageFilter()
-    , m_negativeLanguageFilter()
-    , m_keywordFilter()
+    , m_query()
+    , m_engine(new FilterEngine(this))
+    , m_accepted(0)
+    , m_sourceChanged(false)
+    , m_ranked(false)
+    , m_checkStateChanging(false)
 {
+    connect(Library::instance()->lyricsIndex(), SIGNAL(changed()),
+            SLOT(updateLyricsMatches()));
+    connect(m_engine,
+            SIGNAL(evaluated(const QBitArray &, const QVector<qreal> &)),
+            SLOT(applyFilter(const QBitArray &, const QVector<qreal> &)));
 }
 
 SongSortFilterProxyModel::~SongSortFilterProxyModel() {}
 
 void SongSortFilterProxyModel::setFilterString(const QString &filterString)
 {
-    m_filterString = filterString;
-
-    clearLanguageFilter();
-    clearNegativeLanguageFilter();
-    clearKeywordFilter();
-
-    m_onlySelected = false;
-    m_onlyNotSelected = false;
-
-    QString filter = m_filterString;
-    if (filter.contains("!:selection")) {
-        m_onlyNotSelected = true;
-        filter.remove("!:selection");
-    } else if (filter.contains(":selection")) {
-        m_onlySelected = true;
-        filter.remove(":selection");
-    } else if (!filter.contains(":se")) //:se(lection) would be removed
-    {
-        // parse the :keyword parameters and create the appropriate filter
-        QRegExp langFilter("!?:(\\w{2})\\s?");
-        int pos = 0;
-        while ((pos = langFilter.indexIn(m_filterString, pos)) != -1) {
-            QString language = langFilter.cap(1);
-            QLocale locale(language);
-            if (langFilter.cap(0).startsWith("!")) {
-                insertNegativeLanguageFilter(locale.language());
-            } else {
-                insertLanguageFilter(locale.language());
-            }
-            pos += langFilter.matchedLength();
-        }
+    FilterQuery query(filterString);
+    if (!query.lyrics().isEmpty())
+        query.setLyricsMatches(
+            Library::instance()->lyricsIndex()->find(query.lyrics()));
 
-        filter.remove(langFilter);
+    // the displayed rows are those of the previous filter once its
+    // evaluation is applied; setting the same filter again tests
+    // every song
+    bool refines = sourceModel() && !m_engine->isRunning() &&
+                   filterString != m_filterString && query.refines(m_query);
+    m_filterString = filterString;
+    m_query = query;
+    if (!refines) {
+        evaluate();
+        return;
     }
-    m_keywordFilter << filter.split(" ");
-    invalidateFilter();
-}
 
-QString SongSortFilterProxyModel::filterString() const
-{
-    return m_filterString;
+    // the new filter only hides rows: the rows that are hidden by the
+    // previous filter are rejected without being tested again
+    QBitArray candidates(sourceModel()->rowCount());
+    foreach (int row, sourceRows())
+        candidates.setBit(row);
+
+    evaluate(candidates);
 }
 
-bool SongSortFilterProxyModel::filterAcceptsRow(
-    int sourceRow, const QModelIndex &sourceParent) const
+void SongSortFilterProxyModel::evaluate(const QBitArray &candidates)
 {
-    QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
-
-    bool accept = true;
-    if (!m_keywordFilter.isEmpty()) {
-        foreach (QString keyword, m_keywordFilter) {
-            if (keyword.startsWith("!")) {
-                keyword.remove("!");
-                if (sourceModel()
-                        ->data(index, Library::TitleRole)
-                        .toString()
-                        .contains(keyword, Qt::CaseInsensitive) ||
-                    sourceModel()
-                        ->data(index, Library::ArtistRole)
-                        .toString()
-                        .contains(keyword, Qt::CaseInsensitive) ||
-                    sourceModel()
-                        ->data(index, Library::AlbumRole)
-                        .toString()
-                        .contains(keyword, Qt::CaseInsensitive)) {
-                    accept = false;
-                }
-            } else if (!sourceModel()
-                            ->data(index, Library::TitleRole)
-                            .toString()
-                            .contains(keyword, Qt::CaseInsensitive) &&
-                       !sourceModel()
-                            ->data(index, Library::ArtistRole)
-                            .toString()
-                            .contains(keyword, Qt::CaseInsensitive) &&
-                       !sourceModel()
-                            ->data(index, Library::AlbumRole)
-                            .toString()
-                            .contains(keyword, Qt::CaseInsensitive)) {
-                accept = false;
-            }
-        }
+    Songbook *songbook = qobject_cast<Songbook *>(sourceModel());
+    if (!songbook) {
+        invalidateFilter();
+        return;
     }
 
-    if (!m_negativeLanguageFilter.isEmpty())
-        accept = accept &&
-                 !m_negativeLanguageFilter.contains(
-                     sourceModel()
-                         ->data(index, Library::LanguageRole)
-                         .value<QLocale::Language>());
-
-    if (!m_languageFilter.isEmpty())
-        accept =
-            accept &&
-            m_languageFilter.contains(sourceModel()
-                                          ->data(index, Library::LanguageRole)
-                                          .value<QLocale::Language>());
+    // the checked states are only copied when they are filtered
+    QBitArray selection;
+    if (m_query.usesSelection())
+        selection = songbook->selection();
 
-    if (m_onlySelected)
-        accept = accept &&
-                 qobject_cast<Songbook *>(sourceModel())->isChecked(index);
+    m_sourceChanged = false;
+    m_engine->evaluate(Library::instance()->store(), selection, m_query,
+                       candidates);
+}
 
-    if (m_onlyNotSelected)
-        accept = accept &&
-                 !qobject_cast<Songbook *>(sourceModel())->isChecked(index);
+void SongSortFilterProxyModel::applyFilter(const QBitArray &accepted,
+                                           const QVector<qreal> &scores)
+{
+    // the songs have changed during the evaluation
+    if (m_sourceChanged || !sourceModel() ||
+        accepted.size() != sourceModel()->rowCount()) {
+        evaluate();
+        return;
+    }
 
-    return accept;
+    // QSortFilterProxyModel visits every source row again, but each
+    // visit is a bit test: the query itself has been evaluated in the
+    // background, on the candidate rows only for a refinement
+    m_accepted = &accepted;
+    m_query.setFuzzyScores(scores);
+    if (m_query.isFuzzy() || m_ranked) {
+        // the order changes with the similarity of the songs;
+        // rowCount() sorts them again while the accepted rows are known
+        invalidate();
+        rowCount();
+    } else {
+        invalidateFilter();
+    }
+    m_accepted = 0;
+    m_ranked = m_query.isFuzzy();
 }
 
-void SongSortFilterProxyModel::checkAll()
+bool SongSortFilterProxyModel::lessThan(const QModelIndex &left,
+                                        const QModelIndex &right) const
 {
-    int rows = rowCount();
-    Songbook *songbook = qobject_cast<Songbook *>(sourceModel());
-    for (int i = 0; i < rows; ++i) {
-        songbook->setChecked(mapToSource(index(i, 0)), true);
+    // in fuzzy mode, the most similar songs come first; the scores are
+    // indexed by row since the songbook does not reorder the library
+    const QVector<qreal> &scores = m_query.fuzzyScores();
+    if (m_query.isFuzzy() && !scores.isEmpty()) {
+        qreal leftScore = scores.value(left.row());
+        qreal rightScore = scores.value(right.row());
+        if (leftScore != rightScore)
+            return (sortOrder() == Qt::AscendingOrder)
+                       ? leftScore > rightScore
+                       : leftScore < rightScore;
     }
+    return QSortFilterProxyModel::lessThan(left, right);
 }
 
-void SongSortFilterProxyModel::uncheckAll()
+void SongSortFilterProxyModel::sourceChanged()
 {
-    int rows = rowCount();
-    Songbook *songbook = qobject_cast<Songbook *>(sourceModel());
-    for (int i = 0; i < rows; ++i) {
-        songbook->setChecked(mapToSource(index(i, 0)), false);
-    }
+    if (m_engine->isRunning())
+        m_sourceChanged = true;
 }
 
-void SongSortFilterProxyModel::toggleAll()
+void SongSortFilterProxyModel::sourceRowsChanged()
 {
-    int rows = rowCount();
-    Songbook *songbook = qobject_cast<Songbook *>(sourceModel());
-    for (int i = 0; i < rows; ++i) {
-        songbook->toggle(mapToSource(index(i, 0)));
-    }
+    // the fuzzy scores are indexed by row: they are computed again
+    // when the rows move
+    if (!m_engine->isRunning() && m_query.isFuzzy())
+        evaluate();
+    else
+        sourceChanged();
 }
 
-void SongSortFilterProxyModel::insertLanguageFilter(
-    const QLocale::Language &language)
+void SongSortFilterProxyModel::setSourceModel(QAbstractItemModel *model)
 {
-    m_languageFilter.insert(language);
+    m_engine->cancel();
+    if (sourceModel()) {
+        disconnect(sourceModel(), 0, this, SLOT(sourceChanged()));
+        disconnect(sourceModel(), 0, this, SLOT(sourceRowsChanged()));
+        disconnect(sourceModel(), 0, this,
+                   SLOT(checkStateAboutToChange()));
+        disconnect(sourceModel(), 0, this,
+                   SLOT(selectionChanged(const QModelIndex &,
+                                         const QModelIndex &)));
+    }
+
+    QSortFilterProxyModel::setSourceModel(model);
+    if (!model)
+        return;
+
+    connect(model,
+            SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+            SLOT(sourceChanged()));
+    connect(model, SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+            SLOT(sourceRowsChanged()));
+    connect(model, SIGNAL(rowsRemoved(const QModelIndex &, int, int)),
+            SLOT(sourceRowsChanged()));
+    connect(model, SIGNAL(layoutChanged()), SLOT(sourceRowsChanged()));
+    connect(model, SIGNAL(modelReset()), SLOT(sourceRowsChanged()));
+    if (qobject_cast<Songbook *>(model)) {
+        connect(model, SIGNAL(checkStateAboutToChange(const QModelIndex &,
+                                                      const QModelIndex &)),
+                SLOT(checkStateAboutToChange()));
+        connect(model, SIGNAL(checkStateChanged(const QModelIndex &,
+                                                const QModelIndex &)),
+                SLOT(selectionChanged(const QModelIndex &,
+                                      const QModelIndex &)));
+    }
 }
 
-void SongSortFilterProxyModel::removeLanguageFilter(
-    const QLocale::Language &language)
+QString SongSortFilterProxyModel::filterString() const
 {
-    m_languageFilter.remove(language);
+    return m_filterString;
 }
 
-void SongSortFilterProxyModel::clearLanguageFilter()
+bool SongSortFilterProxyModel::filterAcceptsRow(
+    int sourceRow, const QModelIndex &sourceParent) const
 {
-    m_languageFilter.clear();
+    // the rows accepted by the FilterEngine are being applied
+    if (m_accepted)
+        return m_accepted->testBit(sourceRow);
+
+    // rows whose check state changes keep their state here, whatever
+    // the roles QSortFilterProxyModel takes into account; the
+    // selection is filtered by selectionChanged()
+    if (m_checkStateChanging)
+        return mapFromSource(sourceModel()->index(sourceRow, 0, sourceParent))
+            .isValid();
+
+    // otherwise, rows that changed in the songbook are tested one by
+    // one; the songbook does not reorder the rows of the library
+    bool checked = false;
+    if (m_query.usesSelection())
+        checked = qobject_cast<Songbook *>(sourceModel())
+                      ->isChecked(sourceModel()->index(sourceRow, 0,
+                                                       sourceParent));
+
+    return m_query.accepts(Library::instance()->store(), sourceRow, checked);
 }
 
-const QSet<QLocale::Language> &SongSortFilterProxyModel::languageFilter() const
+QVector<int> SongSortFilterProxyModel::sourceRows() const
 {
-    return m_languageFilter;
+    int rows = rowCount();
+    QVector<int> sourceRows(rows);
+    for (int i = 0; i < rows; ++i)
+        sourceRows[i] = mapToSource(index(i, 0)).row();
+    return sourceRows;
 }
 
-void SongSortFilterProxyModel::insertNegativeLanguageFilter(
-    const QLocale::Language &language)
+void SongSortFilterProxyModel::checkAll()
 {
-    m_negativeLanguageFilter.insert(language);
+    qobject_cast<Songbook *>(sourceModel())->setChecked(sourceRows(), true);
 }
 
-void SongSortFilterProxyModel::removeNegativeLanguageFilter(
-    const QLocale::Language &language)
+void SongSortFilterProxyModel::uncheckAll()
 {
-    m_negativeLanguageFilter.remove(language);
+    qobject_cast<Songbook *>(sourceModel())->setChecked(sourceRows(), false);
 }
 
-void SongSortFilterProxyModel::clearNegativeLanguageFilter()
+void SongSortFilterProxyModel::toggleAll()
 {
-    m_negativeLanguageFilter.clear();
+    qobject_cast<Songbook *>(sourceModel())->toggle(sourceRows());
 }
 
-const QSet<QLocale::Language> &
-SongSortFilterProxyModel::negativeLanguageFilter() const
+void SongSortFilterProxyModel::checkStateAboutToChange()
 {
-    return m_negativeLanguageFilter;
+    m_checkStateChanging = true;
 }
 
-void SongSortFilterProxyModel::clearKeywordFilter() { m_keywordFilter.clear(); }
+void SongSortFilterProxyModel::selectionChanged(const QModelIndex &topLeft,
+                                                const QModelIndex &bottomRight)
+{
+    m_checkStateChanging = false;
+    if (!m_query.usesSelection())
+        return;
+
+    // an evaluation in progress has copied the previous selection
+    if (m_engine->isRunning()) {
+        evaluate();
+        return;
+    }
+
+    // only the rows of the changed range may be accepted or rejected:
+    // they are tested here and filtered at once, rather than by a new
+    // evaluation
+    Songbook *songbook = qobject_cast<Songbook *>(sourceModel());
+    const LibraryStore &songs = Library::instance()->store();
+    const QBitArray selection = songbook->selection();
+    QBitArray accepted;
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        bool accepts = m_query.accepts(songs, row, selection.testBit(row));
+        if (accepts == mapFromSource(songbook->index(row, 0)).isValid())
+            continue;
 
-const QStringList &SongSortFilterProxyModel::keywordFilter() const
+        if (accepted.isNull()) {
+            accepted.resize(songbook->rowCount());
+            foreach (int sourceRow, sourceRows())
+                accepted.setBit(sourceRow);
+        }
+        accepted.setBit(row, accepts);
+    }
+
+    if (!accepted.isNull())
+        applyFilter(accepted, m_query.fuzzyScores());
+}
+
+void SongSortFilterProxyModel::updateLyricsMatches()
 {
-    return m_keywordFilter;
+    if (m_query.lyrics().isEmpty())
+        return;
+
+    m_query.setLyricsMatches(
+        Library::instance()->lyricsIndex()->find(m_query.lyrics()));
+    evaluate();
 }
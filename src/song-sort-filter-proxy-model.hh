@@ -20,9 +20,12 @@
 
 #include <QSortFilterProxyModel>
 #include <QString>
-#include <QSet>
-#include <QLocale>
-#include <QStringList>
+#include <QBitArray>
+#include <QVector>
+
+#include "filter-query.hh"
+
+class FilterEngine;
 
 /*!
   \file song-sort-filter-proxy-model.hh
@@ -32,6 +35,8 @@
 
   Allows one to filter the library. Song items are only displayed if
   the match the filter from their artist, title, or album fields.
+  Keywords are compared to the search keys of the library, regardless
+  of case and diacritics.
 */
 class SongSortFilterProxyModel : public QSortFilterProxyModel
 {
@@ -39,7 +44,8 @@ class SongSortFilterProxyModel : public QSortFilterProxyModel
 
 public slots:
     /*!
-    Selects all filtered songs.
+    Selects all filtered songs, through a single call to
+    Songbook::setChecked.
     \sa uncheckAll, toggleAll
   */
     void checkAll();
@@ -57,58 +63,27 @@ public slots:
     void toggleAll();
 
     /*!
-    Filter the view according to \a filterString.
-    A filter string may contain keywords starting with :
-    or negative filters starting with !: (ie :fr or !:en)
+    Filter the view according to \a filterString, which is compiled
+    into a FilterQuery: keywords, field terms such as artist: or
+    capo:, languages (ie :fr or !:en), quoted texts, OR and
+    negation. The words that follow "lyrics:" are searched in the
+    lyrics of the songs through the LyricsIndex of the library.
+
+    A filter string starting with ~ matches the keywords approximately,
+    through the TrigramIndex of the library, and sorts the songs by
+    similarity.
+
+    The filter is evaluated in the background by a FilterEngine.
+    When \a filterString refines the current filter (a longer or
+    an additional keyword, an additional negative language...),
+    only the songs that are currently displayed are tested again.
+    Applying the result still visits every row, but only to test a
+    bit of the result (see filterAcceptsRow). Setting the current
+    filter again refreshes it: every song is tested.
+    \sa FilterQuery
   */
     void setFilterString(const QString &filterString);
 
-    /*!
-    Add a \a language filter. For instance, ":en" hides songs
-    that are not written in english.
-    \sa insertNegativeLanguageFilter, removeLanguageFilter, clearLanguageFilter
-  */
-    void insertLanguageFilter(const QLocale::Language &language);
-
-    /*!
-    Removes a \a language filter.
-    \sa removeNegativeLanguageFilter, insertLanguageFilter, clearLanguageFilter
-  */
-    void removeLanguageFilter(const QLocale::Language &language);
-
-    /*!
-    Removes all language filters.
-    \sa clearNegativeLanguageFilter, insertLanguageFilter, clearLanguageFilter
-  */
-    void clearLanguageFilter();
-
-    /*!
-    Add a negative \a language filter. For instance, "!:en" hides songs
-    that are written in english.
-    \sa insertLanguageFilter, removeNegativeLanguageFilter,
-    clearNegativeLanguageFilter
-  */
-    void insertNegativeLanguageFilter(const QLocale::Language &language);
-
-    /*!
-    Removes a negative \a language filter.
-    \sa removesLanguageFilter, insertNegativeLanguageFilter,
-    clearNegativeLanguageFilter
-  */
-    void removeNegativeLanguageFilter(const QLocale::Language &language);
-
-    /*!
-    Removes all negative language filters.
-    \sa clearLanguageFilter, insertNegativeLanguageFilter,
-    removeNegativeLanguageFilter
-  */
-    void clearNegativeLanguageFilter();
-
-    /*!
-    Clears the filter, displaying all items in the library view.
-   */
-    void clearKeywordFilter();
-
 public:
     /// Constructor.
     SongSortFilterProxyModel(QObject *parent = 0);
@@ -117,45 +92,57 @@ public:
     ~SongSortFilterProxyModel();
 
     /*!
-    Returns the filter.
-    \sa setFilterString
+    Reimplements QSortFilterProxyModel::setSourceModel to evaluate the
+    filter again when the songs of \a model change during an
+    evaluation.
   */
-    QString filterString() const;
+    virtual void setSourceModel(QAbstractItemModel *model);
 
     /*!
-    Returns language filters.
-    \sa insertLanguageFilter, removeLanguageFilter, clearLanguageFilter
+    Returns the filter.
+    \sa setFilterString
   */
-    const QSet<QLocale::Language> &languageFilter() const;
+    QString filterString() const;
 
+protected:
     /*!
-    Returns negative language filters.
-    \sa insertNegativeLanguageFilter, removeNegativeLanguageFilter,
-    clearNegativeLanguageFilter
+    Reimplements QSortFilterProxyModel::filterAcceptsRow
+    to display rows matching the compiled filter string. While the
+    result of a FilterEngine is applied, this is a single bit test.
+    Rows whose check state changes in the Songbook keep their state,
+    even with Qt versions that filter again on any role; when the
+    filter uses the selection, they are tested once the change is
+    done.
   */
-    const QSet<QLocale::Language> &negativeLanguageFilter() const;
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
 
     /*!
-    Returns the keywordFilter.
-    \sa setKeywordFilter
+    Reimplements QSortFilterProxyModel::lessThan to sort the songs by
+    similarity with the keywords in fuzzy mode. The similarities are
+    computed by the FilterEngine and read by source row.
   */
-    const QStringList &keywordFilter() const;
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const;
 
-protected:
-    /*!
-    Reimplements QSortFilterProxyModel::filterAcceptsRow
-    to display rows matching filterString only for title, artist and album
-    columns.
-  */
-    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+private slots:
+    void updateLyricsMatches();
+    void applyFilter(const QBitArray &accepted, const QVector<qreal> &scores);
+    void sourceChanged();
+    void sourceRowsChanged();
+    void checkStateAboutToChange();
+    void selectionChanged(const QModelIndex &topLeft,
+                          const QModelIndex &bottomRight);
 
 private:
-    bool m_onlySelected;
-    bool m_onlyNotSelected;
+    QVector<int> sourceRows() const;
+    void evaluate(const QBitArray &candidates = QBitArray());
+
     QString m_filterString;
-    QSet<QLocale::Language> m_languageFilter;
-    QSet<QLocale::Language> m_negativeLanguageFilter;
-    QStringList m_keywordFilter;
+    FilterQuery m_query;
+    FilterEngine *m_engine;
+    const QBitArray *m_accepted;
+    bool m_sourceChanged;
+    bool m_ranked;
+    bool m_checkStateChanging;
 };
 
 #endif // __SONG_SORT_FILTER_PROXY_MODEL_HH__
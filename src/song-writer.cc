@@ -0,0 +1,121 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "song-writer.hh"
+
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QSaveFile>
+
+#include <QDebug>
+
+SongWriter::SongWriter(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_pending()
+    , m_running()
+{
+    // a single thread keeps the disk writes in order
+    m_pool->setMaxThreadCount(1);
+    connect(qApp, SIGNAL(aboutToQuit()), SLOT(waitForFinished()));
+}
+
+SongWriter::~SongWriter() { waitForFinished(); }
+
+void SongWriter::write(const Song &song)
+{
+    Job job;
+    job.song = song;
+    schedule(song.path, job);
+}
+
+void SongWriter::write(const QString &path, const QImage &cover)
+{
+    Job job;
+    job.cover = cover;
+    schedule(path, job);
+}
+
+bool SongWriter::isWriting(const QString &path) const
+{
+    return m_running.contains(path);
+}
+
+void SongWriter::schedule(const QString &path, const Job &job)
+{
+    if (m_running.contains(path))
+        m_pending.insert(path, job); // replaces an older pending write
+    else
+        start(path, job);
+}
+
+void SongWriter::start(const QString &path, const Job &job)
+{
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, SIGNAL(finished()), SLOT(finished()));
+    m_running.insert(path, watcher);
+    watcher->setFuture(QtConcurrent::run(m_pool, writeFile, path, job));
+}
+
+void SongWriter::finished()
+{
+    done(static_cast<QFutureWatcher<bool> *>(sender()));
+}
+
+void SongWriter::done(QFutureWatcher<bool> *watcher)
+{
+    QString path = m_running.key(watcher);
+    m_running.remove(path);
+    bool success = watcher->result();
+    watcher->deleteLater();
+
+    if (m_pending.contains(path))
+        start(path, m_pending.take(path));
+    else
+        emit(written(path, success));
+}
+
+void SongWriter::waitForFinished()
+{
+    while (!m_running.isEmpty()) {
+        QFutureWatcher<bool> *watcher = m_running.begin().value();
+        watcher->disconnect(this);
+        watcher->waitForFinished();
+        done(watcher);
+    }
+}
+
+bool SongWriter::writeFile(const QString &path, const Job &job)
+{
+    QSaveFile file(path);
+    if (!job.cover.isNull()) {
+        if (!file.open(QIODevice::WriteOnly) || !job.cover.save(&file, "JPG")) {
+            qWarning() << "Unable to write the cover file: " << path;
+            return false;
+        }
+    } else {
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text) ||
+            !Song::toDevice(job.song, &file)) {
+            qWarning() << "Unable to write the song file: " << path;
+            return false;
+        }
+    }
+    return file.commit();
+}
@@ -0,0 +1,108 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __SONG_WRITER_HH__
+#define __SONG_WRITER_HH__
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QImage>
+
+#include "song.hh"
+
+class QThreadPool;
+template <typename T> class QFutureWatcher;
+
+/*!
+  \file song-writer.hh
+  \class SongWriter
+  \brief SongWriter writes songs and covers in the background
+
+  Files are written on a dedicated thread through QSaveFile, so that a
+  crash in the middle of a write leaves the previous file untouched.
+
+  Writes are coalesced per path: while a file is being written, only
+  the last content requested for it is kept and written next.
+
+  \sa Library::saveSong, Library::saveCover
+*/
+class SongWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Constructor.
+    SongWriter(QObject *parent = 0);
+
+    /// Destructor.
+    ~SongWriter();
+
+    /*!
+    Schedules the write of \a song to song.path.
+    \sa written
+  */
+    void write(const Song &song);
+
+    /*!
+    Schedules the write of \a cover as a JPEG image to \a path.
+    \sa written
+  */
+    void write(const QString &path, const QImage &cover);
+
+    /*!
+    Returns true if a write to \a path is in progress or scheduled.
+  */
+    bool isWriting(const QString &path) const;
+
+public slots:
+    /*!
+    Blocks until every scheduled write is done.
+    This slot is called before the application quits.
+  */
+    void waitForFinished();
+
+signals:
+    /*!
+    This signal is emitted when the last write scheduled for \a path is
+    done; \a success is false if the file could not be written.
+  */
+    void written(const QString &path, bool success);
+
+private slots:
+    void finished();
+
+private:
+    struct Job
+    {
+        Song song;
+        QImage cover;
+    };
+
+    static bool writeFile(const QString &path, const Job &job);
+
+    void schedule(const QString &path, const Job &job);
+    void start(const QString &path, const Job &job);
+    void done(QFutureWatcher<bool> *watcher);
+
+    QThreadPool *m_pool;
+    QHash<QString, Job> m_pending;
+    QHash<QString, QFutureWatcher<bool> *> m_running;
+};
+
+#endif // __SONG_WRITER_HH__
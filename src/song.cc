@@ -20,51 +20,267 @@
 
 #include <QFile>
 #include <QFileInfo>
-#include <QRegExp>
+#include <QTextStream>
 #include <QColor>
+#include <QDataStream>
+#include <QIODevice>
 
 #include <QDebug>
 
-const QRegExp Song::reSgFile("(.*)\\\\begin\\{?song\\}?\\{([^\\}]+)\\}[^[]*\\[("
-                             "[^]]*)\\](.*)\\s*\\\\endsong(.*)");
-const QRegExp Song::reArtist("by=\\{?([^,\\{\\}]+)");
-const QRegExp Song::reAlbum("album=\\{?([^,\\{\\}]+)");
-const QRegExp Song::reOriginalSong("original=\\{?([^,\\{\\}]+)");
-const QRegExp Song::reUrl("url=\\{?([^,\\{\\}]+)");
-const QRegExp Song::reCoverName("cover=\\{?([^,\\{\\}]+)");
-const QRegExp Song::reLilypond("\\\\lilypond");
-const QRegExp Song::reLanguage("\\\\selectlanguage\\{([^\\}]+)");
-const QRegExp Song::reColumnCount("\\\\songcolumns\\{([^\\}]+)");
-const QRegExp Song::reCapo("\\\\capo\\{([^\\}]+)");
-const QRegExp Song::reTranspose("\\\\transpose\\{([^\\}]+)");
-const QRegExp Song::reCover("\\\\cover");
+namespace
+{
+/*!
+  A read-only view on the characters of a .sg file, either decoded
+  (Char is QChar) or as UTF-8 bytes (Char is char).
+*/
+template <typename Char> struct Text {
+    const Char *data;
+    int size;
+
+    Text() : data(0), size(0) {}
+    Text(const Char *data, int size) : data(data), size(size) {}
+
+    bool isNull() const { return data == 0; }
+    ushort at(int i) const;
+    Text mid(int position, int length) const
+    {
+        return Text(data + position, length);
+    }
 
-Song Song::fromFile(const QString &path)
+    bool matches(int position, const char *key, int length) const
+    {
+        if (position < 0 || position + length > size)
+            return false;
+        for (int i = 0; i < length; ++i)
+            if (at(position + i) != uchar(key[i]))
+                return false;
+        return true;
+    }
+
+    int indexOf(const char *key, int from = 0) const
+    {
+        const int length = int(qstrlen(key));
+        for (int i = from; i <= size - length; ++i)
+            if (at(i) == uchar(key[0]) && matches(i, key, length))
+                return i;
+        return -1;
+    }
+
+    int lastIndexOf(const char *key, int from) const
+    {
+        const int length = int(qstrlen(key));
+        for (int i = qMin(from, size - length); i >= 0; --i)
+            if (at(i) == uchar(key[0]) && matches(i, key, length))
+                return i;
+        return -1;
+    }
+
+    bool contains(const char *key) const { return indexOf(key) != -1; }
+};
+
+template <> inline ushort Text<QChar>::at(int i) const
 {
-    QFile file(path);
+    return data[i].unicode();
+}
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning() << "Song::fromFile: unable to open " << path;
-        return Song();
+template <> inline ushort Text<char>::at(int i) const { return uchar(data[i]); }
+
+/*!
+  Returns the characters of \a text as a QString.
+*/
+QString toString(const Text<QChar> &text)
+{
+    return text.isNull() ? QString() : QString(text.data, text.size);
+}
+
+/*!
+  Decodes the UTF-8 bytes of \a text; as when the file is read in
+  text mode, carriage returns are dropped.
+*/
+QString toString(const Text<char> &text)
+{
+    if (text.isNull())
+        return QString();
+    QString result = QString::fromUtf8(text.data, text.size);
+    if (result.contains(QLatin1Char('\r')))
+        result.remove(QLatin1Char('\r'));
+    return result;
+}
+
+/*!
+  Delimits the parts of a .sg file:
+  \li everything before \\beginsong (prefix)
+  \li the song title
+  \li the song options (such as artist name, album, cover etc) (options)
+  \li the song contents
+  \li everything after \\endsong (post)
+*/
+template <typename Char> struct SgFile {
+    Text<Char> prefix;
+    Text<Char> title;
+    Text<Char> options;
+    Text<Char> content;
+    Text<Char> post;
+};
+
+/*!
+  Splits \a text into the parts of a .sg file. The song starts at
+  the last \\beginsong header followed by an \\endsong and ends at the
+  last \\endsong.
+  Returns \a false if \a text is not a song.
+*/
+template <typename Char>
+bool splitSgFile(const Text<Char> &text, SgFile<Char> *parts)
+{
+    const char *beginSong = "\\begin";
+    const char *endSong = "\\endsong";
+
+    const int size = text.size;
+    int end = text.lastIndexOf(endSong, size);
+    if (end == -1)
+        return false;
+
+    int begin = text.lastIndexOf(beginSong, end);
+    for (; begin != -1;
+         begin = (begin > 0) ? text.lastIndexOf(beginSong, begin - 1) : -1) {
+        // \beginsong{, \begin{song}{ and variants
+        int i = begin + 6;
+        if (i < size && text.at(i) == '{')
+            ++i;
+        if (!text.matches(i, "song", 4))
+            continue;
+        i += 4;
+        if (i < size && text.at(i) == '}')
+            ++i;
+        if (i >= size || text.at(i) != '{')
+            continue;
+
+        int titleBegin = ++i;
+        while (i < size && text.at(i) != '}')
+            ++i;
+        if (i == titleBegin || i >= size)
+            continue;
+        int titleEnd = i++;
+
+        while (i < size && text.at(i) != '[')
+            ++i;
+        if (i >= size)
+            continue;
+        int optionsBegin = ++i;
+        while (i < size && text.at(i) != ']')
+            ++i;
+        if (i >= size || i >= end)
+            continue;
+        int optionsEnd = i++;
+
+        parts->prefix = text.mid(0, begin);
+        parts->title = text.mid(titleBegin, titleEnd - titleBegin);
+        parts->options = text.mid(optionsBegin, optionsEnd - optionsBegin);
+        parts->content = text.mid(i, end - i);
+        parts->post = text.mid(end + 8, size - end - 8);
+        return true;
     }
+    return false;
+}
 
-    QTextStream stream(&file);
-    stream.setCodec("UTF-8");
-    QString fileStr = stream.readAll();
-    file.close();
+/*!
+  Returns the value that follows the first occurrence of \a key in
+  \a text. If \a isOption is \a true, the value is an option
+  (key={value} or key=value) and stops at any of ",{}"; otherwise it
+  is a macro argument (\\macro{value}) and stops at "}".
+  Returns a null view if there is no such value.
+*/
+template <typename Char>
+Text<Char> value(const Text<Char> &text, const char *key,
+                 bool isOption = false)
+{
+    const int length = int(qstrlen(key));
+    int from = 0;
+    int pos;
+    while ((pos = text.indexOf(key, from)) != -1) {
+        int begin = pos + length;
+        if (isOption && begin < text.size && text.at(begin) == '{')
+            ++begin;
+
+        int end = begin;
+        while (end < text.size) {
+            ushort c = text.at(end);
+            if (c == '}' || (isOption && (c == ',' || c == '{')))
+                break;
+            ++end;
+        }
+        if (end > begin)
+            return text.mid(begin, end - begin);
+        from = pos + 1;
+    }
+    return Text<Char>();
+}
 
-    return Song::fromString(fileStr, path);
+/*!
+  Returns \a true if \a text only contains whitespaces.
+*/
+bool isBlank(const Text<QChar> &text)
+{
+    for (int i = 0; i < text.size; ++i)
+        if (!text.data[i].isSpace())
+            return false;
+    return true;
 }
 
-Song Song::fromString(const QString &text, const QString &path)
+bool isBlank(const Text<char> &text)
 {
-    Song song;
-    reSgFile.indexIn(text);
+    for (int i = 0; i < text.size; ++i) {
+        uchar c = text.data[i];
+        if (c >= 0x80) { // non-ASCII whitespaces
+            QString line = toString(text);
+            return isBlank(Text<QChar>(line.constData(), line.size()));
+        }
+        if (!QChar(c).isSpace())
+            return false;
+    }
+    return true;
+}
+
+/*!
+  Returns \a true if the first non-whitespace character of \a text
+  is \a c.
+*/
+bool startsWith(const Text<QChar> &text, char c)
+{
+    for (int i = 0; i < text.size; ++i)
+        if (!text.data[i].isSpace())
+            return text.data[i] == QLatin1Char(c);
+    return false;
+}
+
+bool startsWith(const Text<char> &text, char c)
+{
+    for (int i = 0; i < text.size; ++i) {
+        uchar b = text.data[i];
+        if (b >= 0x80) {
+            QString line = toString(text.mid(i, text.size - i));
+            return startsWith(Text<QChar>(line.constData(), line.size()), c);
+        }
+        if (!QChar(b).isSpace())
+            return b == uchar(c);
+    }
+    return false;
+}
 
-    QString prefix = reSgFile.cap(1);
-    QString options = reSgFile.cap(3);
-    QString content = reSgFile.cap(4);
-    QString post = reSgFile.cap(5);
+/*!
+  Builds a Song object from the contents \a text of the file \a path.
+  Only the fields that are kept are converted to QString.
+  \sa Song::fromString
+*/
+template <typename Char>
+Song parse(const Text<Char> &text, const QString &path, bool headerOnly)
+{
+    Song song;
+    SgFile<Char> sg;
+    if (!splitSgFile(text, &sg)) {
+        Text<Char> empty(text.data, 0);
+        sg.prefix = sg.title = sg.options = sg.content = sg.post = empty;
+    }
 
     // path
     song.path = path;
@@ -72,142 +288,361 @@ Song Song::fromString(const QString &text, const QString &path)
     // path (for cover)
     song.coverPath = QFileInfo(path).absolutePath();
 
-    reColumnCount.indexIn(prefix);
-    song.columnCount = reColumnCount.cap(1).toInt();
+    song.columnCount = toString(value(sg.prefix, "\\songcolumns{")).toInt();
 
     // title
-    song.title = latexToUtf8(reSgFile.cap(2));
+    song.title = Song::latexToUtf8(toString(sg.title));
 
     // options
-    reArtist.indexIn(options);
-    song.artist = latexToUtf8(reArtist.cap(1)).replace("\\ ", " ");;
+    song.artist = Song::latexToUtf8(toString(value(sg.options, "by=", true)))
+                      .replace("\\ ", " ");
 
-    reAlbum.indexIn(options);
-    song.album = latexToUtf8(reAlbum.cap(1));
+    song.album = Song::latexToUtf8(toString(value(sg.options, "album=", true)));
 
-    reOriginalSong.indexIn(options);
-    song.originalSong = latexToUtf8(reOriginalSong.cap(1));
+    song.originalSong =
+        Song::latexToUtf8(toString(value(sg.options, "original=", true)));
 
-    reUrl.indexIn(options);
-    song.url = reUrl.cap(1).replace("http://", "");
+    song.url = toString(value(sg.options, "url=", true)).replace("http://", "");
     if (song.url.endsWith("/"))
         song.url.chop(1);
     song.isWebsite = !song.url.isEmpty();
 
-    reCoverName.indexIn(options);
-    song.coverName = reCoverName.cap(1);
+    song.coverName = toString(value(sg.options, "cover=", true));
 
     // content
-    song.isLilypond = bool(reLilypond.indexIn(content) > -1);
+    song.isLilypond = sg.content.contains("\\lilypond");
 
     // locale
-    reLanguage.indexIn(prefix);
-    song.locale =
-        QLocale(languageFromString(reLanguage.cap(1)), QLocale::AnyCountry);
+    song.locale = QLocale(Song::languageFromString(
+                              toString(value(sg.prefix, "\\selectlanguage{"))),
+                          QLocale::AnyCountry);
 
     song.capo = 0;
     song.transpose = 0;
 
-    QStringList lines = content.split("\n");
-    QString line;
+    // the preliminary lines (capo, chords...) come before the lyrics
     bool preliminaryFinished = false;
-    foreach (line, lines) {
+    int lineBegin = 0;
+    forever {
+        int lineEnd = lineBegin;
+        while (lineEnd < sg.content.size && sg.content.at(lineEnd) != '\n')
+            ++lineEnd;
+        Text<Char> line = sg.content.mid(lineBegin, lineEnd - lineBegin);
+        lineBegin = lineEnd + 1;
+
         if (!preliminaryFinished) {
-            if (reCapo.indexIn(line) != -1) {
-                song.capo = reCapo.cap(1).toInt();
-                continue;
-            } else if (reTranspose.indexIn(line) != -1) {
-                song.transpose = reTranspose.cap(1).toInt();
-                continue;
+            Text<Char> capo = value(line, "\\capo{");
+            Text<Char> transpose = value(line, "\\transpose{");
+            if (!capo.isNull()) {
+                song.capo = toString(capo).toInt();
+            } else if (!transpose.isNull()) {
+                song.transpose = toString(transpose).toInt();
             } else if (line.contains("\\gtab")) {
-                song.gtabs << line.trimmed();
-                continue;
+                if (!headerOnly)
+                    song.gtabs << toString(line).trimmed();
             } else if (line.contains("\\utab")) {
-                song.utabs << line.trimmed();
-                continue;
-            } else if (reCover.indexIn(line) != -1 ||
-                       line.trimmed().isEmpty()) {
-                continue;
-            } else if (!line.trimmed().startsWith("%")) {
+                if (!headerOnly)
+                    song.utabs << toString(line).trimmed();
+            } else if (line.contains("\\cover") || isBlank(line)) {
+            } else if (!startsWith(line, '%')) {
                 preliminaryFinished = true;
             }
         }
         if (preliminaryFinished) {
-            song.lyrics << line;
+            // the header ends with the preliminary lines
+            if (headerOnly)
+                break;
+            song.lyrics << toString(line);
         }
+
+        if (lineEnd == sg.content.size)
+            break;
     }
     // remove blank line at the end of input
-    if (!song.lyrics.isEmpty())
-        while (song.lyrics.last().trimmed().isEmpty()) {
-            if (song.lyrics.isEmpty())
-                break;
-            song.lyrics.removeLast();
-        }
+    while (!song.lyrics.isEmpty() && song.lyrics.last().trimmed().isEmpty())
+        song.lyrics.removeLast();
 
-    song.scripture << post.split("\n");
+    if (!headerOnly)
+        song.scripture << toString(sg.post).split("\n");
 
     return song;
 }
+}
 
-QString Song::toString(const Song &song)
+Song Song::fromFile(const QString &path)
 {
-    QString text;
-    text.append(QString("\\selectlanguage{%1}\n")
-                    .arg(Song::languageToString(song.locale.language())));
-    if (song.columnCount > 0)
-        text.append(QString("\\songcolumns{%1}\n").arg(song.columnCount));
+    QFile file(path);
 
-    text.append(QString("\\beginsong{%1}\n  [by={%2}")
-                    .arg(utf8ToLatex(song.title))
-                    .arg(utf8ToLatex(song.artist)));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Song::fromFile: unable to open " << path;
+        return Song();
+    }
 
-    if (!song.coverName.isEmpty())
-        text.append(QString(",cov={%1}").arg(song.coverName));
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    QString fileStr = stream.readAll();
+    file.close();
 
-    if (!song.album.isEmpty())
-        text.append(QString(",album={%1}").arg(utf8ToLatex(song.album)));
+    return Song::fromString(fileStr, path);
+}
 
-    if (!song.originalSong.isEmpty())
-        text.append(
-            QString(",%\n  original={%1}").arg(utf8ToLatex(song.originalSong)));
+namespace
+{
+/*!
+  Parses the header of the song whose UTF-8 bytes are the \a size
+  bytes at \a data, skipping the byte order mark.
+*/
+Song parseHeader(const char *data, int size, const QString &path)
+{
+    if (size >= 3 && qstrncmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        data += 3;
+        size -= 3;
+    }
+    return parse(Text<char>(data, size), path, true);
+}
+}
 
-    if (!song.url.isEmpty())
-        text.append(QString(",%\n  url={%1}").arg(song.url));
+Song Song::headerFromFile(const QString &path)
+{
+    QFile file(path);
 
-    text.append(QString("]\n\n"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Song::headerFromFile: unable to open " << path;
+        return Song();
+    }
 
-    if (!song.coverName.isEmpty())
-        text.append(QString("  \\cover\n"));
+    // parse the UTF-8 bytes of the mapped file; only the fields
+    // that are kept are decoded
+    int size = int(file.size());
+    uchar *map = (size > 0) ? file.map(0, size) : 0;
+    if (map) {
+        Song song = parseHeader(reinterpret_cast<const char *>(map), size,
+                                path);
+        file.unmap(map);
+
+        // the file changed size while it was parsed (such as an editor
+        // truncating it before writing it again): the song is read
+        // again from the new contents. Editors that save to a new file
+        // and rename it leave the mapped file untouched; a truncation
+        // in the middle of the parse itself still raises SIGBUS, but
+        // it only lasts the scan of a few kilobytes.
+        if (file.size() == size)
+            return song;
+        file.seek(0);
+    }
 
-    if (song.transpose != 0)
-        text.append(QString("  \\transpose{%1}\n").arg(song.transpose));
+    QByteArray bytes = file.readAll();
+    return parseHeader(bytes.constData(), bytes.size(), path);
+}
 
-    if (song.capo > 0)
-        text.append(QString("  \\capo{%1}\n").arg(song.capo));
+Song Song::fromString(const QString &text, const QString &path,
+                      bool headerOnly)
+{
+    return parse(Text<QChar>(text.constData(), text.size()), path, headerOnly);
+}
 
-    foreach (QString gtab, song.gtabs) {
-        text.append(QString("  %1\n").arg(gtab));
+namespace
+{
+/*!
+  LaTeX sequences of the Latin-1 characters escaped by
+  Song::utf8ToLatex, indexed by character. The full stop is only
+  escaped as part of an ellipsis.
+*/
+struct LatexEscapes {
+    const char *sequence[256];
+
+    LatexEscapes()
+    {
+        for (int i = 0; i < 256; ++i)
+            sequence[i] = 0;
+        sequence[uchar('&')] = "\\&";
+        sequence[uchar('~')] = "\\~";
+        sequence[uchar('%')] = "\\%";
+        sequence[uchar('.')] = "\\dots";
+        sequence[QChar::Nbsp] = "~";
     }
+};
+
+/*!
+  Collects the UTF-8 encoding of the text appended to it, with the
+  subset of the QString interface used by the serializer.
+  \sa Song::toDevice
+*/
+struct Utf8Text {
+    QByteArray bytes;
+
+    void reserve(int size) { bytes.reserve(size); }
+
+    // the markup is ASCII
+    void append(QLatin1Char c) { bytes.append(c.toLatin1()); }
+    void append(QLatin1String str) { bytes.append(str.data(), str.size()); }
+    void append(const QString &str) { append(str.constData(), str.size()); }
+
+    /*!
+      ASCII characters are copied as is; the other ones are encoded
+      run by run by QString::toUtf8 so that the bytes are the same as
+      those of the whole text encoded at once.
+    */
+    void append(const QChar *data, int size)
+    {
+        const QChar *end = data + size;
+        while (data != end) {
+            if (data->unicode() < 0x80) {
+                bytes.append(char((data++)->unicode()));
+                continue;
+            }
+            const QChar *run = data;
+            while (data != end && data->unicode() >= 0x80)
+                ++data;
+            bytes.append(QString::fromRawData(run, int(data - run)).toUtf8());
+        }
+    }
+};
+
+/*!
+  Appends \a str to \a text with its LaTeX special characters escaped.
+  Runs of plain characters are copied at once.
+  \sa Song::utf8ToLatex
+*/
+template <typename Text> void appendLatex(Text &text, const QString &str)
+{
+    static const LatexEscapes escapes;
+
+    const QChar *plain = str.constData();
+    const QChar *end = plain + str.size();
+    for (const QChar *c = plain; c != end; ++c) {
+        ushort u = c->unicode();
+        if (u > 0xff || !escapes.sequence[u])
+            continue;
+        if (u == '.' && (end - c < 3 || c[1] != QLatin1Char('.') ||
+                         c[2] != QLatin1Char('.')))
+            continue;
+
+        text.append(plain, int(c - plain));
+        text.append(QLatin1String(escapes.sequence[u]));
+        if (u == '.')
+            c += 2;
+        plain = c + 1;
+    }
+    text.append(plain, int(end - plain));
+}
+
+template <typename Text>
+void appendLines(Text &text, const QStringList &lines, const char *indent)
+{
+    foreach (const QString &line, lines) {
+        text.append(QLatin1String(indent));
+        text.append(line);
+        text.append(QLatin1Char('\n'));
+    }
+}
+
+int linesSize(const QStringList &lines)
+{
+    int size = 0;
+    foreach (const QString &line, lines)
+        size += line.size() + 3;
+    return size;
+}
 
-    foreach (QString utab, song.utabs) {
-        text.append(QString("  %1\n").arg(utab));
+/*!
+  Appends the contents of \a song to \a text, either a QString or
+  a Utf8Text.
+  \sa Song::toString, Song::toDevice
+*/
+template <typename Text> void appendSong(Text &text, const Song &song)
+{
+    // a few characters for the markup and the escape sequences
+    text.reserve(256 + song.title.size() + song.artist.size() +
+                 song.album.size() + song.originalSong.size() +
+                 song.url.size() + song.coverName.size() +
+                 linesSize(song.gtabs) + linesSize(song.utabs) +
+                 linesSize(song.lyrics) + linesSize(song.scripture));
+
+    text.append(QLatin1String("\\selectlanguage{"));
+    text.append(Song::languageToString(song.locale.language()));
+    text.append(QLatin1String("}\n"));
+    if (song.columnCount > 0) {
+        text.append(QLatin1String("\\songcolumns{"));
+        text.append(QString::number(song.columnCount));
+        text.append(QLatin1String("}\n"));
     }
 
-    text.append(QString("\n"));
+    text.append(QLatin1String("\\beginsong{"));
+    appendLatex(text, song.title);
+    text.append(QLatin1String("}\n  [by={"));
+    appendLatex(text, song.artist);
+    text.append(QLatin1Char('}'));
+
+    if (!song.coverName.isEmpty()) {
+        text.append(QLatin1String(",cov={"));
+        text.append(song.coverName);
+        text.append(QLatin1Char('}'));
+    }
 
-    foreach (QString lyric, song.lyrics) {
-        text.append(QString("%1\n").arg(lyric));
+    if (!song.album.isEmpty()) {
+        text.append(QLatin1String(",album={"));
+        appendLatex(text, song.album);
+        text.append(QLatin1Char('}'));
     }
 
-    text.append(QString("\\endsong\n"));
+    if (!song.originalSong.isEmpty()) {
+        text.append(QLatin1String(",%\n  original={"));
+        appendLatex(text, song.originalSong);
+        text.append(QLatin1Char('}'));
+    }
 
-    foreach (QString line, song.scripture) {
-        text.append(QString("%1\n").arg(line));
+    if (!song.url.isEmpty()) {
+        text.append(QLatin1String(",%\n  url={"));
+        text.append(song.url);
+        text.append(QLatin1Char('}'));
     }
 
+    text.append(QLatin1String("]\n\n"));
+
+    if (!song.coverName.isEmpty())
+        text.append(QLatin1String("  \\cover\n"));
+
+    if (song.transpose != 0) {
+        text.append(QLatin1String("  \\transpose{"));
+        text.append(QString::number(song.transpose));
+        text.append(QLatin1String("}\n"));
+    }
+
+    if (song.capo > 0) {
+        text.append(QLatin1String("  \\capo{"));
+        text.append(QString::number(song.capo));
+        text.append(QLatin1String("}\n"));
+    }
+
+    appendLines(text, song.gtabs, "  ");
+    appendLines(text, song.utabs, "  ");
+
+    text.append(QLatin1Char('\n'));
+
+    appendLines(text, song.lyrics, "");
+
+    text.append(QLatin1String("\\endsong\n"));
+
+    appendLines(text, song.scripture, "");
+}
+}
+
+QString Song::toString(const Song &song)
+{
+    QString text;
+    appendSong(text, song);
     return text;
 }
 
+bool Song::toDevice(const Song &song, QIODevice *device)
+{
+    // encode the fields one by one rather than the whole QString
+    Utf8Text text;
+    appendSong(text, song);
+    return device->write(text.bytes) >= 0;
+}
+
 QLocale::Language Song::languageFromString(const QString &languageName)
 {
     if (languageName == "french")
@@ -244,21 +679,93 @@ QString Song::languageToString(const QLocale::Language language)
 
 QString Song::latexToUtf8(const QString &str)
 {
-    QString result(str);
-    result.replace(QRegExp("([^\\\\])~"),
-                   QString("\\1%1").arg(QChar(QChar::Nbsp)));
-    result.replace(QRegExp("\\\\([&~])"), "\\1");
-    result.replace(QRegExp("\\{?\\\\l?dots\\}?"), "...");
+    // most strings do not contain any LaTeX sequence
+    if (!str.contains(QLatin1Char('\\')) && !str.contains(QLatin1Char('~')))
+        return str;
+
+    const QChar nbsp(QChar::Nbsp);
+    QString result;
+    QString tmp;
+    result.reserve(str.size());
+
+    // c~ -> c<nbsp> (unless c is a backslash)
+    for (int i = 0; i < str.size(); ++i) {
+        if (i + 1 < str.size() && str[i] != QLatin1Char('\\') &&
+            str[i + 1] == QLatin1Char('~')) {
+            result += str[i];
+            result += nbsp;
+            ++i;
+        } else {
+            result += str[i];
+        }
+    }
+
+    // \& -> &, \~ -> ~
+    tmp.swap(result);
+    result.clear();
+    for (int i = 0; i < tmp.size(); ++i) {
+        if (tmp[i] == QLatin1Char('\\') && i + 1 < tmp.size() &&
+            (tmp[i + 1] == QLatin1Char('&') || tmp[i + 1] == QLatin1Char('~')))
+            ++i;
+        result += tmp[i];
+    }
+
+    // {\dots}, \ldots... -> ...
+    tmp.swap(result);
+    result.clear();
+    for (int i = 0; i < tmp.size(); ++i) {
+        int j = i;
+        if (tmp[j] == QLatin1Char('{'))
+            ++j;
+        if (j < tmp.size() && tmp[j] == QLatin1Char('\\')) {
+            ++j;
+            if (j < tmp.size() && tmp[j] == QLatin1Char('l'))
+                ++j;
+            if (tmp.midRef(j, 4) == QLatin1String("dots")) {
+                j += 4;
+                if (j < tmp.size() && tmp[j] == QLatin1Char('}'))
+                    ++j;
+                result += QLatin1String("...");
+                i = j - 1;
+                continue;
+            }
+        }
+        result += tmp[i];
+    }
+
     result.replace("\\%", "%");
     return result;
 }
 
 QString Song::utf8ToLatex(const QString &str)
 {
-    QString result(str);
-    result.replace(QRegExp("([&~])"), "\\\\1");
-    result.replace(QChar(QChar::Nbsp), "~");
-    result.replace("...", "\\dots");
-    result.replace("%", "\\%");
+    QString result;
+    result.reserve(str.size() + 8);
+    appendLatex(result, str);
     return result;
 }
+
+QDataStream &operator<<(QDataStream &out, const Song &song)
+{
+    out << song.title << song.artist << song.album << song.originalSong
+        << song.url << song.coverName << song.coverPath << song.path
+        << song.locale << song.isLilypond << song.isWebsite
+        << qint32(song.columnCount) << qint32(song.capo)
+        << qint32(song.transpose) << song.gtabs << song.utabs << song.lyrics
+        << song.scripture;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, Song &song)
+{
+    qint32 columnCount, capo, transpose;
+    in >> song.title >> song.artist >> song.album >> song.originalSong >>
+        song.url >> song.coverName >> song.coverPath >> song.path >>
+        song.locale >> song.isLilypond >> song.isWebsite >> columnCount >>
+        capo >> transpose >> song.gtabs >> song.utabs >> song.lyrics >>
+        song.scripture;
+    song.columnCount = columnCount;
+    song.capo = capo;
+    song.transpose = transpose;
+    return in;
+}
@@ -23,6 +23,9 @@
 #include <QStringList>
 #include <QLocale>
 
+class QDataStream;
+class QIODevice;
+
 /*!
   \file song.hh
   \struct Song "song.hh"
@@ -59,12 +62,23 @@ struct Song {
   */
     static Song fromFile(const QString &path);
 
+    /*!
+    Constructs a Song object from the header of the file whose absolute
+    path is \a path: the chords, the lyrics and the scripture are not
+    loaded. This is all the library needs to list the song.
+    \sa fromFile
+  */
+    static Song headerFromFile(const QString &path);
+
     /*!
     Constructs a Song object whose content is \a text.
+    If \a headerOnly is \a true, the chords, the lyrics and the
+    scripture are skipped.
     \sa fromString, toString
   */
     static Song fromString(const QString &text,
-                           const QString &path = QString());
+                           const QString &path = QString(),
+                           bool headerOnly = false);
 
     /*!
     Returns the contents of the song \a song.
@@ -72,6 +86,15 @@ struct Song {
   */
     static QString toString(const Song &song);
 
+    /*!
+    Writes the contents of the song \a song to \a device as UTF-8.
+    The fields are encoded one by one into a buffer sized for the
+    song, without building the whole text as a QString first.
+    Returns \a false if the contents could not be written.
+    \sa toString
+  */
+    static bool toDevice(const Song &song, QIODevice *device);
+
     /*!
     Converts a language string \a languageName to a QLocale object.
     Language strings are usually strings used by babel (LaTeX module).
@@ -101,72 +124,18 @@ struct Song {
     \sa latexToUtf8
   */
     static QString utf8ToLatex(const QString &str);
+};
 
-    /*!
-    Extracts the contents of a .sg file.
-    This regular expression captures 5 fields:
-    \li everything before \\beginsong (prefix)
-    \li the song title
-    \li the song options (such as artist name, album, cover etc) (options)
-    \li the song contents
-    \li everything after \\endsong (post)
-   */
-    const static QRegExp reSgFile;
-
-    /*!
-    Extracts the artist of the song from a .sg file.
-  */
-    const static QRegExp reArtist;
-
-    /*!
-    Extracts the album of the song from a .sg file.
-  */
-    const static QRegExp reAlbum;
-
-    /*!
-    Extracts the original song of the song from a .sg file.
-  */
-    const static QRegExp reOriginalSong;
-
-    /*!
-    Extracts the artist website of the song from a .sg file.
-  */
-    const static QRegExp reUrl;
-
-    /*!
-    Extracts the cover of the song from a .sg file.
-  */
-    const static QRegExp reCoverName;
-
-    /*!
-    Looks for lilypond macros within a .sg file.
-  */
-    const static QRegExp reLilypond;
-
-    /*!
-    Extracts the language of the song from a .sg file.
-  */
-    const static QRegExp reLanguage;
-
-    /*!
-    Extracts the number of columns of the song from a .sg file.
-  */
-    const static QRegExp reColumnCount;
-
-    /*!
-    Extracts the capo of the song from a .sg file.
-  */
-    const static QRegExp reCapo;
-
-    /*!
-    Extracts the transposition information of the song from a .sg file.
-  */
-    const static QRegExp reTranspose;
+/*!
+  Writes the song \a song to the stream \a out.
+  \relates Song
+*/
+QDataStream &operator<<(QDataStream &out, const Song &song);
 
-    /*!
-    Extracts the cover filename associated with the song from a .sg file.
-  */
-    const static QRegExp reCover;
-};
+/*!
+  Reads a song from the stream \a in into \a song.
+  \relates Song
+*/
+QDataStream &operator>>(QDataStream &in, Song &song);
 
 #endif // __SONG_HH__
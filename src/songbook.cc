@@ -19,6 +19,7 @@
 #include "songbook.hh"
 
 #include <QDir>
+#include <QSet>
 #include <QFile>
 #include <QMessageBox>
 
@@ -41,11 +42,14 @@
 #include "yaml-cpp/yaml.h"
 #include <QDebug>
 
+#include <algorithm>
+
 Songbook::Songbook(QObject *parent)
     : IdentityProxyModel(parent)
     , m_filename()
     , m_tmpl()
     , m_selectedSongs()
+    , m_selectedCount(0)
     , m_songs()
     , m_modified()
     , m_propertyManager(new VariantManager())
@@ -511,64 +515,120 @@ QString Songbook::workingPath() const
 
 bool Songbook::isChecked(const QModelIndex &index)
 {
-    return m_selectedSongs[index.row()];
+    return m_selectedSongs.testBit(index.row());
+}
+
+QBitArray Songbook::selection() const { return m_selectedSongs; }
+
+void Songbook::check(int row, bool checked)
+{
+    if (m_selectedSongs.testBit(row) != checked) {
+        m_selectedSongs.setBit(row, checked);
+        m_selectedCount += checked ? 1 : -1;
+    }
+}
+
+QDir Songbook::songsDirectory() const
+{
+    // the library paths are built from the absolute path
+    return QDir(library()->directory().absolutePath() + "/songs");
+}
+
+void Songbook::emitCheckStateChanged(int first, int last)
+{
+    if (first > last)
+        return;
+
+    // proxies may skip filtering and sorting these rows again between
+    // checkStateAboutToChange() and checkStateChanged()
+    QModelIndex topLeft = index(first, 0);
+    QModelIndex bottomRight = index(last, 0);
+    emit(checkStateAboutToChange(topLeft, bottomRight));
+    emit(dataChanged(topLeft, bottomRight,
+                     QVector<int>() << Qt::CheckStateRole));
+    emit(checkStateChanged(topLeft, bottomRight));
 }
 
 void Songbook::setChecked(const QModelIndex &index, bool checked)
 {
     if (isChecked(index) != checked) {
-        m_selectedSongs[index.row()] = checked;
-        emit(dataChanged(index, index));
+        check(index.row(), checked);
+        emitCheckStateChanged(index.row(), index.row());
     }
 }
 
 void Songbook::toggle(const QModelIndex &index)
 {
-    m_selectedSongs[index.row()] = !m_selectedSongs[index.row()];
-    emit(dataChanged(index, index));
+    check(index.row(), !isChecked(index));
+    emitCheckStateChanged(index.row(), index.row());
 }
 
-void Songbook::checkAll()
+void Songbook::setChecked(const QVector<int> &rows, bool checked)
 {
-    for (int i = 0; i < m_selectedSongs.size(); ++i) {
-        m_selectedSongs[i] = true;
-    }
-    emit(dataChanged(index(0, 0), index(m_selectedSongs.size() - 1, 0)));
+    checkRows(rows, false, checked);
 }
 
-void Songbook::uncheckAll()
+void Songbook::toggle(const QVector<int> &rows)
 {
-    for (int i = 0; i < m_selectedSongs.size(); ++i) {
-        m_selectedSongs[i] = false;
-    }
-    emit(dataChanged(index(0, 0), index(m_selectedSongs.size() - 1, 0)));
+    checkRows(rows, true, false);
 }
 
-void Songbook::toggleAll()
+void Songbook::checkRows(QVector<int> rows, bool toggle, bool checked)
 {
-    for (int i = 0; i < m_selectedSongs.size(); ++i) {
-        m_selectedSongs[i] = !m_selectedSongs[i];
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    // a single notification covers the changed rows, so that proxies
+    // filter and sort again once per call rather than once per range
+    int first = -1;
+    int last = -1;
+    foreach (int row, rows) {
+        bool state = toggle ? !m_selectedSongs.testBit(row) : checked;
+        if (state == m_selectedSongs.testBit(row))
+            continue;
+
+        check(row, state);
+        if (first == -1)
+            first = row;
+        last = row;
     }
-    emit(dataChanged(index(0, 0), index(m_selectedSongs.size() - 1, 0)));
+    emitCheckStateChanged(first, last);
 }
 
-int Songbook::selectedCount() const
+void Songbook::checkAll()
 {
-    int count = 0;
-    for (int i = 0; i < m_selectedSongs.size(); ++i) {
-        if (m_selectedSongs[i])
-            count++;
-    }
-    return count;
+    m_selectedSongs.fill(true);
+    m_selectedCount = m_selectedSongs.size();
+    emitCheckStateChanged(0, m_selectedSongs.size() - 1);
+}
+
+void Songbook::uncheckAll()
+{
+    m_selectedSongs.fill(false);
+    m_selectedCount = 0;
+    emitCheckStateChanged(0, m_selectedSongs.size() - 1);
+}
+
+void Songbook::toggleAll()
+{
+    m_selectedSongs = ~m_selectedSongs;
+    m_selectedCount = m_selectedSongs.size() - m_selectedCount;
+    emitCheckStateChanged(0, m_selectedSongs.size() - 1);
 }
 
+int Songbook::selectedCount() const { return m_selectedCount; }
+
 void Songbook::songsFromSelection()
 {
     m_songs.clear();
+    m_songs.reserve(m_selectedCount);
+
+    const LibraryStore &store = library()->store();
+    QDir directory = songsDirectory();
     QString song;
     for (int i = 0; i < m_selectedSongs.size(); ++i) {
-        if (m_selectedSongs[i]) {
-            song = data(index(i, 0), Library::RelativePathRole).toString();
+        if (m_selectedSongs.testBit(i)) {
+            song = directory.relativeFilePath(store.path(i));
 #ifdef Q_WS_WIN
             song.replace("\\", "/");
 #endif
@@ -579,33 +639,37 @@ void Songbook::songsFromSelection()
 
 void Songbook::songsToSelection()
 {
-    if (m_songs.isEmpty())
-        uncheckAll();
+    m_selectedSongs.fill(false);
+    m_selectedCount = 0;
 
-    for (int i = 0; i < m_selectedSongs.size(); ++i) {
-        m_selectedSongs[i] = false;
-        if (m_songs.contains(
-                data(index(i, 0), Library::RelativePathRole).toString()))
-            m_selectedSongs[i] = true;
+    QDir directory = songsDirectory();
+    foreach (const QString &song, m_songs) {
+        int row = library()->getSongIndex(
+            QDir::cleanPath(directory.filePath(song)));
+        if (row != -1 && row < m_selectedSongs.size())
+            check(row, true);
     }
-    emit(dataChanged(index(0, 0), index(m_selectedSongs.size() - 1, 0)));
+    emitCheckStateChanged(0, m_selectedSongs.size() - 1);
 }
 
 void Songbook::selectLanguages(const QStringList &languages)
 {
+    m_selectedCount = 0;
     for (int i = 0; i < m_selectedSongs.size(); ++i) {
-        m_selectedSongs[i] = false;
-        if (languages.contains(
-                data(index(i, 0), Library::LanguageRole).toString()))
-            m_selectedSongs[i] = true;
+        bool checked = languages.contains(
+            data(index(i, 0), Library::LanguageRole).toString());
+        m_selectedSongs.setBit(i, checked);
+        if (checked)
+            ++m_selectedCount;
     }
-    emit(dataChanged(index(0, 0), index(m_selectedSongs.size() - 1, 0)));
+    emitCheckStateChanged(0, m_selectedSongs.size() - 1);
 }
 
 QVariant Songbook::data(const QModelIndex &index, int role) const
 {
     if (index.column() == 0 && role == Qt::CheckStateRole) {
-        return (m_selectedSongs[index.row()] ? Qt::Checked : Qt::Unchecked);
+        return (m_selectedSongs.testBit(index.row()) ? Qt::Checked
+                                                      : Qt::Unchecked);
     }
     return IdentityProxyModel::data(index, role);
 }
@@ -621,8 +685,8 @@ bool Songbook::setData(const QModelIndex &index, const QVariant &value,
                        int role)
 {
     if (index.column() == 0 && role == Qt::CheckStateRole) {
-        m_selectedSongs[index.row()] = value.toBool();
-        emit(dataChanged(index, index));
+        check(index.row(), value.toBool());
+        emitCheckStateChanged(index.row(), index.row());
         return true;
     }
     return IdentityProxyModel::setData(index, value, role);
@@ -636,10 +700,44 @@ void Songbook::sourceModelAboutToBeReset()
 
 void Songbook::sourceModelReset()
 {
-    m_selectedSongs.clear();
-    for (int i = 0; i < sourceModel()->rowCount(); ++i) {
-        m_selectedSongs << false;
-    }
+    m_selectedSongs = QBitArray(sourceModel()->rowCount());
+    m_selectedCount = 0;
     songsToSelection();
     endResetModel();
 }
+
+void Songbook::sourceRowsInserted(const QModelIndex &parent, int start,
+                                  int end)
+{
+    Q_UNUSED(parent);
+    int count = end - start + 1;
+    int size = m_selectedSongs.size();
+    m_selectedSongs.resize(size + count);
+    for (int i = size - 1; i >= start; --i)
+        m_selectedSongs.setBit(i + count, m_selectedSongs.testBit(i));
+    for (int i = start; i <= end; ++i)
+        m_selectedSongs.clearBit(i);
+
+    // new songs are checked if they belong to the songbook
+    const LibraryStore &store = library()->store();
+    QDir directory = songsDirectory();
+    QSet<QString> songs = m_songs.toSet();
+    for (int i = start; i <= end; ++i) {
+        if (songs.contains(directory.relativeFilePath(store.path(i))))
+            check(i, true);
+    }
+    endInsertRows();
+}
+
+void Songbook::sourceRowsRemoved(const QModelIndex &parent, int start,
+                                 int end)
+{
+    Q_UNUSED(parent);
+    int count = end - start + 1;
+    for (int i = start; i <= end; ++i)
+        check(i, false);
+    for (int i = end + 1; i < m_selectedSongs.size(); ++i)
+        m_selectedSongs.setBit(i - count, m_selectedSongs.testBit(i));
+    m_selectedSongs.resize(m_selectedSongs.size() - count);
+    endRemoveRows();
+}
@@ -22,6 +22,8 @@
 #include "identity-proxy-model.hh"
 
 #include <QDir>
+#include <QBitArray>
+#include <QVector>
 #include <QString>
 #include <QStringList>
 
@@ -142,6 +144,20 @@ public slots:
   */
     void toggle(const QModelIndex &index);
 
+    /*!
+    Checks or unchecks the songs at positions \a rows, in any order.
+    The rows whose state changes are grouped into contiguous ranges,
+    and signals are emitted once per range.
+    \sa toggle, checkStateChanged
+  */
+    void setChecked(const QVector<int> &rows, bool checked);
+
+    /*!
+    Toggles the selection of the songs at positions \a rows.
+    \sa setChecked, checkStateChanged
+  */
+    void toggle(const QVector<int> &rows);
+
 public:
     /// Constructor.
     Songbook(QObject *parent);
@@ -180,6 +196,7 @@ public:
 
     /*!
     Returns the number of selected songs for this songbook.
+    The count is maintained as songs are checked, so this is cheap.
   */
     int selectedCount() const;
     void selectLanguages(const QStringList &languages);
@@ -192,7 +209,8 @@ public:
 
     /*!
     Updates the selection from the list of songs of the songbook.
-    \sa songsToSelection
+    Songs are looked up by path in the library.
+    \sa songsFromSelection
   */
     void songsToSelection();
 
@@ -220,6 +238,12 @@ public:
   */
     bool isChecked(const QModelIndex &index);
 
+    /*!
+    Returns the checked state of every song, by row.
+    \sa isChecked
+  */
+    QBitArray selection() const;
+
     virtual QVariant data(const QModelIndex &index,
                           int role = Qt::DisplayRole) const;
     virtual Qt::ItemFlags flags(const QModelIndex &index) const;
@@ -230,16 +254,44 @@ signals:
     void wasModified(bool modified);
     void songsChanged();
 
+    /*!
+    This signal is emitted right before dataChanged() is emitted for
+    the check state of the songs from \a topLeft to \a bottomRight,
+    so that proxies can tell these changes apart.
+    \sa checkStateChanged
+  */
+    void checkStateAboutToChange(const QModelIndex &topLeft,
+                                 const QModelIndex &bottomRight);
+
+    /*!
+    This signal is emitted when the songs from \a topLeft to
+    \a bottomRight are checked or unchecked, after dataChanged() has
+    been emitted for the Qt::CheckStateRole only. The songs changed
+    by a single call are reported at once, so the range may include
+    songs whose check state did not change.
+    \sa checkStateAboutToChange
+  */
+    void checkStateChanged(const QModelIndex &topLeft,
+                           const QModelIndex &bottomRight);
+
 private slots:
     void sourceModelAboutToBeReset();
     void sourceModelReset();
+    void sourceRowsInserted(const QModelIndex &parent, int start, int end);
+    void sourceRowsRemoved(const QModelIndex &parent, int start, int end);
 
 private:
+    void check(int row, bool checked);
+    void checkRows(QVector<int> rows, bool toggle, bool checked);
+    void emitCheckStateChanged(int first, int last);
+    QDir songsDirectory() const;
+
     QString m_filename;
     QString m_tmpl;
     QStringList m_datadirs;
 
-    QList<bool> m_selectedSongs;
+    QBitArray m_selectedSongs;
+    int m_selectedCount;
     QStringList m_songs;
 
     bool m_modified;
@@ -0,0 +1,122 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "text-folding.hh"
+
+namespace
+{
+/*!
+  Base letters of the characters below U+2000 that have a canonical
+  decomposition, that is their NFD form without combining marks;
+  0 for the other characters.
+*/
+struct Decompositions {
+    enum { Size = 0x2000 };
+    ushort base[Size];
+
+    Decompositions()
+    {
+        for (int i = 0; i < Size; ++i) {
+            QChar c(i);
+            ushort u = 0;
+            while (c.decompositionTag() == QChar::Canonical) {
+                c = c.decomposition().at(0);
+                u = c.unicode();
+            }
+            base[i] = u;
+        }
+    }
+};
+
+// letters that have no decomposition
+const char *transliterate(ushort u)
+{
+    switch (u) {
+    case 0x00df: // sharp s
+        return "ss";
+    case 0x00e6: // ae
+        return "ae";
+    case 0x00f0: // eth
+    case 0x0111: // d with stroke
+        return "d";
+    case 0x00f8: // o with stroke
+        return "o";
+    case 0x00fe: // thorn
+        return "th";
+    case 0x0127: // h with stroke
+        return "h";
+    case 0x0131: // dotless i
+        return "i";
+    case 0x0142: // l with stroke
+        return "l";
+    case 0x0153: // oe
+        return "oe";
+    case 0x0167: // t with stroke
+        return "t";
+    default:
+        return 0;
+    }
+}
+}
+
+void appendFolded(QString &text, QChar c)
+{
+    static const Decompositions decompositions;
+
+    c = c.toLower();
+    if (c.isMark())
+        return;
+
+    ushort u = c.unicode();
+    if (u < 0x80)
+        text.append(c);
+    else if (const char *latin = transliterate(u))
+        text.append(QLatin1String(latin));
+    else if (u < Decompositions::Size && decompositions.base[u])
+        text.append(QChar(decompositions.base[u]));
+    else
+        text.append(c);
+}
+
+QString fold(const QString &text)
+{
+    QString result;
+    result.reserve(text.size());
+    const QChar *end = text.constData() + text.size();
+    for (const QChar *it = text.constData(); it != end; ++it)
+        appendFolded(result, *it);
+    return result;
+}
+
+QStringList foldedWords(const QString &text)
+{
+    QStringList words;
+    QString word;
+    const QChar *end = text.constData() + text.size();
+    for (const QChar *it = text.constData(); it != end; ++it) {
+        if (it->isLetterOrNumber()) {
+            appendFolded(word, *it);
+        } else if (!it->isMark() && !word.isEmpty()) {
+            words << word;
+            word.clear();
+        }
+    }
+    if (!word.isEmpty())
+        words << word;
+    return words;
+}
@@ -0,0 +1,54 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __TEXT_FOLDING_HH__
+#define __TEXT_FOLDING_HH__
+
+#include <QString>
+#include <QStringList>
+
+/*!
+  \file text-folding.hh
+  \brief Case and diacritic insensitive forms of strings
+
+  Folding a character lowercases it and replaces it with the base
+  letter of its canonical decomposition (NFD without combining
+  marks): "É" and "é" are both folded to "e". Letters that have no
+  decomposition are transliterated ("ß" to "ss", "œ" to "oe"...).
+  Combining marks are dropped.
+
+  These forms are used for file names and for searching the library.
+*/
+
+/*!
+  Appends the folded form of \a c to \a text.
+*/
+void appendFolded(QString &text, QChar c);
+
+/*!
+  Returns the folded form of \a text.
+*/
+QString fold(const QString &text);
+
+/*!
+  Returns the folded words of \a text: sequences of letters and
+  numbers separated by any other character.
+*/
+QStringList foldedWords(const QString &text);
+
+#endif // __TEXT_FOLDING_HH__
@@ -0,0 +1,234 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "thumbnail-cache.hh"
+
+#include "main-window.hh"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+
+#include <algorithm>
+
+#include <QDebug>
+
+const quint32 ThumbnailCache::_magic = 0x50475448; // "PGTH"
+const quint32 ThumbnailCache::_version = 1;
+
+ThumbnailCache::ThumbnailCache()
+    : QObject()
+    , m_directory(QString("%1/thumbnails").arg(MainWindow::_cachePath))
+    , m_maximumSize(50 * 1024 * 1024)
+    , m_totalSize(0)
+    , m_entries()
+    , m_modified(false)
+    , m_mutex()
+{
+    QDir().mkpath(m_directory);
+    load();
+    connect(qApp, SIGNAL(aboutToQuit()), SLOT(save()));
+}
+
+ThumbnailCache::~ThumbnailCache() {}
+
+qint64 ThumbnailCache::maximumSize() const { return m_maximumSize; }
+
+void ThumbnailCache::setMaximumSize(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maximumSize = bytes;
+    evict();
+}
+
+QString ThumbnailCache::filePath(const QString &name) const
+{
+    return QString("%1/%2").arg(m_directory).arg(name);
+}
+
+QImage ThumbnailCache::scaledImage(const QString &path, const QSize &size)
+{
+    QImageReader reader(path);
+    QSize imageSize = reader.size();
+    if (!imageSize.isValid()) {
+        // the format cannot tell its size before decoding
+        QImage image = reader.read();
+        if (image.isNull())
+            return image;
+        return (size.height() > 0) ? image.scaled(size)
+                                   : image.scaledToWidth(size.width());
+    }
+
+    QSize scaledSize(size);
+    if (size.height() <= 0)
+        scaledSize.setHeight(
+            qMax(1, imageSize.height() * size.width() / imageSize.width()));
+
+    // JPEG images are downscaled while being decoded
+    reader.setScaledSize(scaledSize);
+    return reader.read();
+}
+
+QImage ThumbnailCache::thumbnail(const QString &path, const QSize &size)
+{
+    QFileInfo file(path);
+    if (!file.exists())
+        return QImage();
+
+    QString key = QString("%1@%2@%3x%4")
+                      .arg(file.absoluteFilePath())
+                      .arg(file.lastModified().toMSecsSinceEpoch())
+                      .arg(size.width())
+                      .arg(size.height());
+    QString name = QString("%1.jpg").arg(QString(
+        QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1)
+            .toHex()));
+
+    bool cached;
+    {
+        QMutexLocker locker(&m_mutex);
+        cached = m_entries.contains(name);
+    }
+
+    QImage image;
+    if (cached) {
+        image.load(filePath(name), "JPG");
+        if (!image.isNull()) {
+            QMutexLocker locker(&m_mutex);
+            if (m_entries.contains(name))
+                touch(name, m_entries[name].size);
+            return image;
+        }
+    }
+
+    image = scaledImage(path, size);
+    if (image.isNull())
+        return image;
+
+    QSaveFile thumbnailFile(filePath(name));
+    if (thumbnailFile.open(QIODevice::WriteOnly) &&
+        image.save(&thumbnailFile, "JPG", 90) && thumbnailFile.commit()) {
+        QMutexLocker locker(&m_mutex);
+        touch(name, QFileInfo(filePath(name)).size());
+        evict();
+    }
+    return image;
+}
+
+void ThumbnailCache::touch(const QString &name, qint64 size)
+{
+    QHash<QString, Entry>::iterator it = m_entries.find(name);
+    if (it == m_entries.end()) {
+        it = m_entries.insert(name, Entry());
+        it.value().size = 0;
+    }
+    m_totalSize += size - it.value().size;
+    it.value().size = size;
+    it.value().lastUsed = QDateTime::currentMSecsSinceEpoch();
+    m_modified = true;
+}
+
+void ThumbnailCache::evict()
+{
+    if (m_totalSize <= m_maximumSize)
+        return;
+
+    QList<QPair<qint64, QString> > entries;
+    entries.reserve(m_entries.size());
+    QHash<QString, Entry>::const_iterator it;
+    for (it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        entries << qMakePair(it.value().lastUsed, it.key());
+    std::sort(entries.begin(), entries.end());
+
+    // leave some room so that the next thumbnails do not evict again
+    qint64 target = m_maximumSize * 3 / 4;
+    for (int i = 0; i < entries.size() && m_totalSize > target; ++i) {
+        const QString &name = entries[i].second;
+        QFile::remove(filePath(name));
+        m_totalSize -= m_entries.take(name).size;
+    }
+    m_modified = true;
+}
+
+void ThumbnailCache::load()
+{
+    // last uses from the previous sessions
+    QHash<QString, qint64> lastUsed;
+    QFile index(filePath("index"));
+    if (index.open(QIODevice::ReadOnly)) {
+        QDataStream in(&index);
+        in.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic, version, count;
+        in >> magic >> version >> count;
+        if (magic == _magic && version == _version) {
+            QString name;
+            qint64 time;
+            for (quint32 i = 0; i < count && in.status() == QDataStream::Ok;
+                 ++i) {
+                in >> name >> time;
+                lastUsed.insert(name, time);
+            }
+        }
+    }
+
+    // the directory is authoritative: the index may be outdated if the
+    // application did not quit properly
+    QFileInfoList files =
+        QDir(m_directory).entryInfoList(QStringList() << "*.jpg", QDir::Files);
+    foreach (const QFileInfo &file, files) {
+        Entry entry;
+        entry.size = file.size();
+        entry.lastUsed = lastUsed.value(
+            file.fileName(), file.lastModified().toMSecsSinceEpoch());
+        m_entries.insert(file.fileName(), entry);
+        m_totalSize += entry.size;
+    }
+    evict();
+}
+
+void ThumbnailCache::save()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_modified)
+        return;
+
+    QSaveFile index(filePath("index"));
+    if (!index.open(QIODevice::WriteOnly)) {
+        qWarning() << "ThumbnailCache::save: unable to open"
+                   << index.fileName();
+        return;
+    }
+
+    QDataStream out(&index);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << _magic << _version << quint32(m_entries.size());
+    QHash<QString, Entry>::const_iterator it;
+    for (it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        out << it.key() << it.value().lastUsed;
+
+    if (out.status() == QDataStream::Ok && index.commit())
+        m_modified = false;
+}
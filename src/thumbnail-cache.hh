@@ -0,0 +1,112 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __THUMBNAIL_CACHE_HH__
+#define __THUMBNAIL_CACHE_HH__
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QSize>
+#include <QImage>
+#include <QMutex>
+
+#include "singleton.hh"
+
+/*!
+  \file thumbnail-cache.hh
+  \class ThumbnailCache
+  \brief ThumbnailCache keeps scaled covers on disk across sessions
+
+  Each thumbnail is stored as a JPEG file in the thumbnails directory
+  of the application cache. Its name is derived from the path and the
+  modification time of the cover, and from the size of the thumbnail,
+  so that a modified cover is never served from an outdated entry.
+
+  The total size of the thumbnails is capped: the least recently used
+  ones are removed first. The last use of each entry is kept in an
+  index file, written when the application quits.
+
+  thumbnail() is thread-safe and is called from the threads of the
+  Thumbnailer as well as from dialogs that need a single cover.
+*/
+class ThumbnailCache : public QObject, public Singleton<ThumbnailCache>
+{
+    Q_OBJECT
+
+    friend class Singleton<ThumbnailCache>;
+
+private:
+    /// Constructor.
+    ThumbnailCache();
+    /// Destructor.
+    ~ThumbnailCache();
+
+public:
+    /*!
+    Returns the image \a path scaled to \a size, or a null image if
+    \a path cannot be read. The image is only decoded if there is no
+    valid thumbnail for it on disk yet.
+    If the height of \a size is 0, the aspect ratio of the image is
+    kept and only its width is scaled.
+  */
+    QImage thumbnail(const QString &path, const QSize &size);
+
+    /*!
+    Returns the maximum size in bytes of the thumbnails on disk.
+    \sa setMaximumSize
+  */
+    qint64 maximumSize() const;
+
+    /*!
+    Sets the maximum size in bytes of the thumbnails on disk.
+    \sa maximumSize
+  */
+    void setMaximumSize(qint64 bytes);
+
+public slots:
+    /*!
+    Writes the index of the thumbnails if it has been modified.
+  */
+    void save();
+
+private:
+    struct Entry {
+        qint64 size;     /*!< size of the thumbnail file in bytes.*/
+        qint64 lastUsed; /*!< last access (ms since epoch).*/
+    };
+
+    static QImage scaledImage(const QString &path, const QSize &size);
+
+    QString filePath(const QString &name) const;
+    void load();
+    void touch(const QString &name, qint64 size);
+    void evict();
+
+    static const quint32 _magic;
+    static const quint32 _version;
+
+    QString m_directory;
+    qint64 m_maximumSize;
+    qint64 m_totalSize;
+    QHash<QString, Entry> m_entries;
+    bool m_modified;
+    QMutex m_mutex;
+};
+
+#endif // __THUMBNAIL_CACHE_HH__
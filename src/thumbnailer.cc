@@ -0,0 +1,109 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "thumbnailer.hh"
+
+#include "thumbnail-cache.hh"
+#include "image-cache.hh"
+
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+Thumbnailer::Thumbnailer()
+    : QObject()
+    , m_sizes()
+    , m_requested()
+    , m_failed()
+    , m_pending()
+{
+    // created in the main thread before any worker uses it
+    ThumbnailCache::instance();
+}
+
+Thumbnailer::~Thumbnailer() {}
+
+QString Thumbnailer::key(const QString &path, const QSize &size)
+{
+    return QString("%1@%2x%3").arg(path).arg(size.width()).arg(size.height());
+}
+
+QImage Thumbnailer::read(const QString &path, const QSize &size)
+{
+    return ThumbnailCache::instance()->thumbnail(path, size);
+}
+
+QPixmap Thumbnailer::thumbnail(const QString &path, const QSize &size)
+{
+    QPixmap pixmap;
+    if (path.isEmpty() || m_failed.contains(path))
+        return pixmap;
+
+    QString thumbnailKey = key(path, size);
+    ImageCache *cache = ImageCache::instance();
+    if (cache->find(ImageCache::Covers, thumbnailKey, &pixmap) ||
+        m_requested.contains(thumbnailKey))
+        return pixmap;
+
+    if (!m_sizes.contains(size))
+        m_sizes << size;
+
+    Request request;
+    request.path = path;
+    request.size = size;
+
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, SIGNAL(finished()), SLOT(finished()));
+    m_requested.insert(thumbnailKey, watcher);
+    m_pending.insert(watcher, request);
+    watcher->setFuture(QtConcurrent::run(read, path, size));
+    return pixmap;
+}
+
+void Thumbnailer::finished()
+{
+    QFutureWatcher<QImage> *watcher =
+        static_cast<QFutureWatcher<QImage> *>(sender());
+    Request request = m_pending.take(watcher);
+    QImage image = watcher->result();
+    watcher->deleteLater();
+
+    QString thumbnailKey = key(request.path, request.size);
+    // the image has been invalidated in the meantime
+    if (m_requested.value(thumbnailKey) != watcher)
+        return;
+    m_requested.remove(thumbnailKey);
+
+    if (image.isNull()) {
+        m_failed << request.path;
+        return;
+    }
+
+    ImageCache::instance()->insert(ImageCache::Covers, thumbnailKey,
+                                   QPixmap::fromImage(image));
+    emit(thumbnailReady(request.path));
+}
+
+void Thumbnailer::invalidate(const QString &path)
+{
+    m_failed.remove(path);
+    foreach (const QSize &size, m_sizes) {
+        QString thumbnailKey = key(path, size);
+        ImageCache::instance()->remove(ImageCache::Covers, thumbnailKey);
+        m_requested.remove(thumbnailKey);
+    }
+}
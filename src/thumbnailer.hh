@@ -0,0 +1,105 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __THUMBNAILER_HH__
+#define __THUMBNAILER_HH__
+
+#include <QObject>
+#include <QString>
+#include <QSize>
+#include <QSet>
+#include <QHash>
+#include <QList>
+#include <QPixmap>
+#include <QImage>
+
+#include "singleton.hh"
+
+template <typename T> class QFutureWatcher;
+
+/*!
+  \file thumbnailer.hh
+  \class Thumbnailer
+  \brief Thumbnailer decodes cover thumbnails in the background
+
+  Covers are read on the global thread pool from the ThumbnailCache,
+  which only decodes them if there is no thumbnail on disk yet.
+  The thumbnails are then kept in the QPixmapCache.
+
+  thumbnail() never blocks: if the thumbnail is not cached yet, a null
+  pixmap is returned so that the caller can draw a placeholder, and
+  thumbnailReady() is emitted once the image is decoded.
+
+  \sa Library::data
+*/
+class Thumbnailer : public QObject, public Singleton<Thumbnailer>
+{
+    Q_OBJECT
+
+    friend class Singleton<Thumbnailer>;
+
+private:
+    /// Constructor.
+    Thumbnailer();
+    /// Destructor.
+    ~Thumbnailer();
+
+public:
+    /*!
+    Returns the thumbnail of the image \a path scaled to \a size, or a
+    null pixmap if it is not available yet or cannot be read.
+    If the height of \a size is 0, the aspect ratio of the image is
+    kept and only its width is scaled.
+    \sa thumbnailReady
+  */
+    QPixmap thumbnail(const QString &path, const QSize &size);
+
+    /*!
+    Drops the thumbnails of the image \a path, for instance because the
+    file has been written.
+  */
+    void invalidate(const QString &path);
+
+signals:
+    /*!
+    This signal is emitted when a thumbnail of the image \a path has
+    been decoded.
+    \sa thumbnail
+  */
+    void thumbnailReady(const QString &path);
+
+private slots:
+    void finished();
+
+private:
+    struct Request
+    {
+        QString path;
+        QSize size;
+    };
+
+    static QString key(const QString &path, const QSize &size);
+    static QImage read(const QString &path, const QSize &size);
+
+    QList<QSize> m_sizes;
+    QHash<QString, QFutureWatcher<QImage> *> m_requested;
+    QSet<QString> m_failed;
+    QHash<QFutureWatcher<QImage> *, Request> m_pending;
+};
+
+#endif // __THUMBNAILER_HH__
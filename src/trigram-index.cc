@@ -0,0 +1,198 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "trigram-index.hh"
+
+#include "text-folding.hh"
+
+#include <algorithm>
+
+TrigramIndex::TrigramIndex()
+    : m_words()
+    , m_trigramCounts()
+    , m_trigramWords()
+    , m_wordRows()
+    , m_rowWords()
+{
+}
+
+TrigramIndex::~TrigramIndex() {}
+
+QVector<quint64> TrigramIndex::trigrams(const QString &word)
+{
+    QString padded = QLatin1String("  ") + word + QLatin1Char(' ');
+    QVector<quint64> result;
+    result.reserve(padded.size() - 2);
+    for (int i = 0; i + 2 < padded.size(); ++i) {
+        result << ((quint64(padded[i].unicode()) << 32) |
+                   (quint64(padded[i + 1].unicode()) << 16) |
+                   quint64(padded[i + 2].unicode()));
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+int TrigramIndex::insertWord(const QString &word)
+{
+    QHash<QString, int>::const_iterator it = m_words.constFind(word);
+    if (it != m_words.constEnd())
+        return it.value();
+
+    int id = m_wordRows.size();
+    m_words.insert(word, id);
+    m_wordRows << QVector<int>();
+
+    QVector<quint64> grams = trigrams(word);
+    m_trigramCounts << grams.size();
+    foreach (quint64 gram, grams)
+        m_trigramWords[gram] << id;
+    return id;
+}
+
+void TrigramIndex::insert(int row, const QString &text)
+{
+    if (row < m_rowWords.size())
+        removeRow(row);
+    else
+        m_rowWords.resize(row + 1);
+
+    QStringList words = foldedWords(text);
+    words.removeDuplicates();
+
+    QVector<int> ids;
+    ids.reserve(words.size());
+    foreach (const QString &word, words) {
+        int id = insertWord(word);
+
+        // rows are mostly indexed in increasing order
+        QVector<int> &rows = m_wordRows[id];
+        if (rows.isEmpty() || rows.last() < row)
+            rows.append(row);
+        else
+            rows.insert(std::lower_bound(rows.begin(), rows.end(), row) -
+                            rows.begin(),
+                        row);
+        ids << id;
+    }
+    m_rowWords[row] = ids;
+}
+
+void TrigramIndex::removeRow(int row)
+{
+    foreach (int id, m_rowWords[row]) {
+        QVector<int> &rows = m_wordRows[id];
+        QVector<int>::iterator it =
+            std::lower_bound(rows.begin(), rows.end(), row);
+        if (it != rows.end() && *it == row)
+            rows.erase(it);
+    }
+    m_rowWords[row].clear();
+}
+
+void TrigramIndex::remove(int first, int last)
+{
+    last = qMin(last, m_rowWords.size() - 1);
+    if (first > last)
+        return;
+
+    for (int row = first; row <= last; ++row)
+        removeRow(row);
+
+    int count = last - first + 1;
+    for (int id = 0; id < m_wordRows.size(); ++id) {
+        QVector<int> &rows = m_wordRows[id];
+        QVector<int>::iterator it =
+            std::upper_bound(rows.begin(), rows.end(), last);
+        for (; it != rows.end(); ++it)
+            *it -= count;
+    }
+    m_rowWords.remove(first, count);
+}
+
+void TrigramIndex::clear()
+{
+    m_words.clear();
+    m_trigramCounts.clear();
+    m_trigramWords.clear();
+    m_wordRows.clear();
+    m_rowWords.clear();
+}
+
+QHash<int, qreal> TrigramIndex::search(const QStringList &words,
+                                       qreal threshold) const
+{
+    QHash<int, qreal> scores;
+    QVector<int> shared(m_trigramCounts.size(), 0);
+    QVector<int> candidates;
+
+    for (int i = 0; i < words.size(); ++i) {
+        QVector<quint64> grams = trigrams(words[i]);
+
+        // count the trigrams that each word shares with the query word
+        foreach (quint64 gram, grams) {
+            QHash<quint64, QVector<int> >::const_iterator it =
+                m_trigramWords.constFind(gram);
+            if (it == m_trigramWords.constEnd())
+                continue;
+            foreach (int id, it.value()) {
+                if (shared[id]++ == 0)
+                    candidates << id;
+            }
+        }
+
+        // best similarity of each row for this query word
+        QHash<int, qreal> best;
+        foreach (int id, candidates) {
+            qreal similarity =
+                qreal(shared[id]) /
+                (grams.size() + m_trigramCounts[id] - shared[id]);
+            shared[id] = 0;
+            if (similarity < threshold)
+                continue;
+
+            foreach (int row, m_wordRows[id]) {
+                if (i > 0 && !scores.contains(row))
+                    continue;
+                QHash<int, qreal>::iterator it = best.find(row);
+                if (it == best.end())
+                    best.insert(row, similarity);
+                else if (it.value() < similarity)
+                    it.value() = similarity;
+            }
+        }
+        candidates.clear();
+
+        // rows must match every query word
+        if (i == 0) {
+            scores = best;
+        } else {
+            QHash<int, qreal>::iterator it = best.begin();
+            for (; it != best.end(); ++it)
+                it.value() += scores.value(it.key());
+            scores = best;
+        }
+        if (scores.isEmpty())
+            break;
+    }
+
+    QHash<int, qreal>::iterator it = scores.begin();
+    for (; it != scores.end(); ++it)
+        it.value() /= words.size();
+    return scores;
+}
@@ -0,0 +1,95 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __TRIGRAM_INDEX_HH__
+#define __TRIGRAM_INDEX_HH__
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+
+/*!
+  \file trigram-index.hh
+  \class TrigramIndex
+  \brief TrigramIndex finds the rows whose words look like a misspelt
+  query
+
+  Each distinct folded word of the indexed rows is split into its
+  trigrams, padded with two spaces in front and one behind ("goldman"
+  gives "  g", " go", "gol"... "an "). A query word is compared to the
+  words that share at least one trigram with it, by the Jaccard index
+  of their trigram sets, so that "brasens" still finds "brassens".
+
+  Trigrams are associated with words rather than with rows: artists
+  and albums repeat across songs, so the vocabulary is much smaller
+  than the library.
+
+  \sa LibraryStore::trigramIndex
+*/
+class TrigramIndex
+{
+public:
+    /// Constructor.
+    TrigramIndex();
+
+    /// Destructor.
+    ~TrigramIndex();
+
+    /*!
+    Indexes the words of \a text for the row \a row, replacing its
+    previous entry.
+    \sa remove
+  */
+    void insert(int row, const QString &text);
+
+    /*!
+    Removes the rows from \a first to \a last and shifts the following
+    rows accordingly.
+    \sa insert
+  */
+    void remove(int first, int last);
+
+    /*!
+    Removes all rows.
+  */
+    void clear();
+
+    /*!
+    Returns the rows that contain a word similar to each of the folded
+    \a words, with their similarity between 0 and 1. The similarity of
+    a row is the mean of the best similarity of each word; words that
+    are less similar than \a threshold are ignored.
+  */
+    QHash<int, qreal> search(const QStringList &words,
+                             qreal threshold = 0.3) const;
+
+private:
+    static QVector<quint64> trigrams(const QString &word);
+
+    int insertWord(const QString &word);
+    void removeRow(int row);
+
+    QHash<QString, int> m_words;
+    QVector<int> m_trigramCounts;
+    QHash<quint64, QVector<int> > m_trigramWords;
+    QVector<QVector<int> > m_wordRows;
+    QVector<QVector<int> > m_rowWords;
+};
+
+#endif // __TRIGRAM_INDEX_HH__
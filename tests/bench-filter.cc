@@ -0,0 +1,208 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "library-store.hh"
+#include "filter-engine.hh"
+#include "filter-query.hh"
+
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QtTest>
+
+#include <algorithm>
+
+/*!
+  \class BenchFilter
+  \brief Measures the filter of the library view on a large library
+
+  The library holds 40000 generated songs, a few of which are by
+  Georges Brassens. Each keystroke of the fuzzy query "~brasens"
+  (misspelt on purpose) is evaluated by a FilterEngine, scores
+  included, and the accepted rows are ranked as
+  SongSortFilterProxyModel::lessThan does. A keystroke should take
+  less than 20 ms.
+*/
+class BenchFilter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void search_data();
+    void search();
+
+    void keystroke_data();
+    void keystroke();
+
+    void budget();
+
+private:
+    void addKeystrokeRows();
+    bool type(FilterEngine &engine, const QString &filter);
+
+    LibraryStore m_songs;
+};
+
+namespace
+{
+const int SongCount = 40000;
+const int BudgetMs = 20;
+
+/*!
+  Returns a made-up word of two or three syllables for \a n.
+*/
+QString word(int n)
+{
+    static const char *syllables[] = {"ba", "ko",  "ri", "sen", "ta", "mu",
+                                      "lo", "vi",  "dra", "ne", "po", "gu",
+                                      "shi", "fa", "zer", "mon"};
+    QString result;
+    do {
+        result += QLatin1String(syllables[n % 16]);
+        n /= 16;
+    } while (n > 0 && result.size() < 9);
+    return result;
+}
+
+QString words(int count)
+{
+    QStringList list;
+    for (int i = 0; i < count; ++i)
+        list << word(qrand() % 4096);
+    return list.join(" ");
+}
+
+/*!
+  Ranks \a rows by decreasing \a scores, as the proxy model does.
+*/
+void rank(QVector<int> &rows, const QVector<qreal> &scores)
+{
+    struct BySimilarity {
+        const QVector<qreal> &scores;
+        bool operator()(int left, int right) const
+        {
+            return scores.value(left) > scores.value(right);
+        }
+    };
+    BySimilarity bySimilarity = {scores};
+    std::sort(rows.begin(), rows.end(), bySimilarity);
+}
+}
+
+void BenchFilter::initTestCase()
+{
+    // for QSignalSpy
+    qRegisterMetaType<QVector<qreal> >("QVector<qreal>");
+
+    qsrand(1);
+    m_songs.reserve(SongCount);
+    for (int i = 0; i < SongCount; ++i) {
+        Song song = Song();
+        if (i % 1000 == 0) {
+            song.artist = "Georges Brassens";
+            song.album = "Les Copains d'abord";
+        } else {
+            song.artist = words(2);
+            song.album = words(2);
+        }
+        song.title = words(3);
+        song.path = QString("/songs/%1.sg").arg(i);
+        song.coverPath = "/songs";
+        song.locale = QLocale(QLocale::French);
+        m_songs.append(song);
+    }
+    QCOMPARE(m_songs.size(), SongCount);
+}
+
+void BenchFilter::addKeystrokeRows()
+{
+    QTest::addColumn<QString>("filter");
+
+    const QString typed = "~brasens";
+    for (int i = 2; i <= typed.size(); ++i)
+        QTest::newRow(qPrintable(typed.left(i))) << typed.left(i);
+    QTest::newRow("brassens") << QString("brassens");
+}
+
+void BenchFilter::search_data() { addKeystrokeRows(); }
+
+void BenchFilter::search()
+{
+    QFETCH(QString, filter);
+
+    FilterQuery query(filter);
+    if (!query.isFuzzy())
+        QSKIP("not a fuzzy query");
+
+    QBENCHMARK { m_songs.trigramIndex().search(query.fuzzyWords()); }
+}
+
+/*!
+  Evaluates \a filter with \a engine and ranks the accepted rows.
+  Returns false if the evaluation did not finish.
+*/
+bool BenchFilter::type(FilterEngine &engine, const QString &filter)
+{
+    QSignalSpy spy(&engine, SIGNAL(evaluated(const QBitArray &,
+                                             const QVector<qreal> &)));
+    engine.evaluate(m_songs, QBitArray(), FilterQuery(filter));
+    if (spy.isEmpty() && !spy.wait(10000))
+        return false;
+
+    const QBitArray accepted = spy.first().at(0).value<QBitArray>();
+    const QVector<qreal> scores = spy.first().at(1).value<QVector<qreal> >();
+    QVector<int> rows;
+    for (int row = 0; row < accepted.size(); ++row)
+        if (accepted.testBit(row))
+            rows << row;
+    if (!scores.isEmpty())
+        rank(rows, scores);
+    return true;
+}
+
+void BenchFilter::keystroke_data() { addKeystrokeRows(); }
+
+void BenchFilter::keystroke()
+{
+    QFETCH(QString, filter);
+
+    FilterEngine engine;
+    QBENCHMARK { QVERIFY(type(engine, filter)); }
+}
+
+void BenchFilter::budget()
+{
+    FilterEngine engine;
+    const QString typed = "~brasens";
+    QElapsedTimer timer;
+    qint64 slowest = 0;
+    for (int i = 2; i <= typed.size(); ++i) {
+        timer.start();
+        QVERIFY(type(engine, typed.left(i)));
+        slowest = qMax(slowest, timer.elapsed());
+    }
+
+    qDebug("%d songs: slowest keystroke %lld ms (budget %d ms)", SongCount,
+           slowest, BudgetMs);
+    if (slowest > BudgetMs)
+        QWARN("a keystroke exceeds the budget");
+}
+
+QTEST_GUILESS_MAIN(BenchFilter)
+#include "bench-filter.moc"
@@ -0,0 +1,191 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "song.hh"
+#include "reference-song.hh"
+#include "corpus.hh"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QtTest>
+
+/*!
+  \class BenchSong
+  \brief Measures the .sg parser and serializer against the former ones
+
+  Each parser benchmark has a "regex" row for Reference and a "lexer"
+  row for Song; the parser is expected to be about ten times faster.
+  The serializer benchmarks check that Song writes the same bytes as
+  Reference before measuring them.
+*/
+class BenchSong : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void fromString_data();
+    void fromString();
+
+    void headerFromFile_data();
+    void headerFromFile();
+
+    void speedup();
+
+    void toString_data();
+    void toString();
+
+    void toDevice_data();
+    void toDevice();
+
+private:
+    void addParserRows();
+    void addSerializerRows();
+
+    QStringList m_paths;
+    QStringList m_texts;
+    QList<Song> m_songs;
+};
+
+void BenchSong::initTestCase()
+{
+    m_paths = corpusFiles();
+    QVERIFY(!m_paths.isEmpty());
+    foreach (const QString &path, m_paths)
+        m_texts << readCorpusFile(path);
+    for (int i = 0; i < m_texts.size(); ++i)
+        m_songs << Reference::fromString(m_texts[i], m_paths[i]);
+}
+
+void BenchSong::addParserRows()
+{
+    QTest::addColumn<bool>("reference");
+    QTest::newRow("regex") << true;
+    QTest::newRow("lexer") << false;
+}
+
+void BenchSong::addSerializerRows()
+{
+    QTest::addColumn<bool>("reference");
+    QTest::newRow("arg") << true;
+    QTest::newRow("append") << false;
+}
+
+void BenchSong::fromString_data() { addParserRows(); }
+
+void BenchSong::fromString()
+{
+    QFETCH(bool, reference);
+
+    QBENCHMARK {
+        for (int i = 0; i < m_texts.size(); ++i) {
+            if (reference)
+                Reference::fromString(m_texts[i], m_paths[i]);
+            else
+                Song::fromString(m_texts[i], m_paths[i]);
+        }
+    }
+}
+
+void BenchSong::headerFromFile_data() { addParserRows(); }
+
+void BenchSong::headerFromFile()
+{
+    QFETCH(bool, reference);
+
+    QBENCHMARK {
+        foreach (const QString &path, m_paths) {
+            if (reference)
+                Reference::fromFile(path);
+            else
+                Song::headerFromFile(path);
+        }
+    }
+}
+
+void BenchSong::speedup()
+{
+    // parse the corpus until each parser has run for a while
+    const int rounds = qMax(1, 20000 / m_texts.size());
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int round = 0; round < rounds; ++round)
+        for (int i = 0; i < m_texts.size(); ++i)
+            Reference::fromString(m_texts[i], m_paths[i]);
+    const qint64 regex = qMax<qint64>(1, timer.nsecsElapsed());
+
+    timer.restart();
+    for (int round = 0; round < rounds; ++round)
+        for (int i = 0; i < m_texts.size(); ++i)
+            Song::fromString(m_texts[i], m_paths[i]);
+    const qint64 lexer = qMax<qint64>(1, timer.nsecsElapsed());
+
+    qDebug("fromString: regex %lld ms, lexer %lld ms, %.1fx faster",
+           regex / 1000000, lexer / 1000000, double(regex) / lexer);
+}
+
+void BenchSong::toString_data() { addSerializerRows(); }
+
+void BenchSong::toString()
+{
+    QFETCH(bool, reference);
+
+    foreach (const Song &song, m_songs)
+        QCOMPARE(Song::toString(song), Reference::toString(song));
+
+    QBENCHMARK {
+        foreach (const Song &song, m_songs) {
+            if (reference)
+                Reference::toString(song);
+            else
+                Song::toString(song);
+        }
+    }
+}
+
+void BenchSong::toDevice_data() { addSerializerRows(); }
+
+void BenchSong::toDevice()
+{
+    QFETCH(bool, reference);
+
+    foreach (const Song &song, m_songs) {
+        QBuffer check;
+        check.open(QIODevice::WriteOnly);
+        QVERIFY(Song::toDevice(song, &check));
+        QCOMPARE(check.data(), Reference::toString(song).toUtf8());
+    }
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    // the former toDevice encoded the whole text once it was built
+    QBENCHMARK {
+        foreach (const Song &song, m_songs) {
+            buffer.seek(0);
+            if (reference)
+                buffer.write(Reference::toString(song).toUtf8());
+            else
+                Song::toDevice(song, &buffer);
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchSong)
+#include "bench-song.moc"
@@ -0,0 +1,55 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "corpus.hh"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+QString corpusDirectory()
+{
+    QString directory = QString::fromLocal8Bit(qgetenv("PATAGUI_TEST_SONGS"));
+    if (directory.isEmpty())
+        directory = QLatin1String(SONGS_CORPUS_DIR);
+    return directory;
+}
+
+QStringList corpusFiles()
+{
+    QStringList files;
+    QDirIterator it(corpusDirectory(), QStringList() << "*.sg", QDir::Files,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext())
+        files << QFileInfo(it.next()).absoluteFilePath();
+    files.sort();
+    return files;
+}
+
+QString readCorpusFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QString();
+
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    return stream.readAll();
+}
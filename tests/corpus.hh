@@ -0,0 +1,50 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __CORPUS_HH__
+#define __CORPUS_HH__
+
+#include <QStringList>
+
+/*!
+  \file corpus.hh
+  \brief .sg files the parser tests and benchmarks run on
+
+  The corpus is the tests/data directory. Setting the
+  PATAGUI_TEST_SONGS environment variable to a songs directory (such
+  as the one of a patacrep songbook) runs the same tests on its
+  files instead.
+*/
+
+/*!
+  Returns the directory of the corpus.
+*/
+QString corpusDirectory();
+
+/*!
+  Returns the absolute paths of the .sg files of the corpus.
+*/
+QStringList corpusFiles();
+
+/*!
+  Returns the contents of the file \a path, read as Song::fromFile
+  does.
+*/
+QString readCorpusFile(const QString &path);
+
+#endif // __CORPUS_HH__
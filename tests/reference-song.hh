@@ -0,0 +1,68 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#ifndef __REFERENCE_SONG_HH__
+#define __REFERENCE_SONG_HH__
+
+#include "song.hh"
+
+/*!
+  \file reference-song.hh
+  \brief Regular expression based .sg parser and serializer
+
+  The parser and serializer that Song used before the single-pass
+  lexer and the preallocated serializer, kept as is so that the tests
+  can check that both read and write the same .sg files and the
+  benchmarks can measure the difference.
+*/
+namespace Reference
+{
+/*!
+  Constructs a Song object whose content is \a text, as the former
+  Song::fromString did.
+  \sa fromFile
+*/
+Song fromString(const QString &text, const QString &path = QString());
+
+/*!
+  Constructs a Song object from the file \a path, as the former
+  Song::fromFile did.
+  \sa fromString
+*/
+Song fromFile(const QString &path);
+
+/*!
+  Converts LaTeX special sequences to utf8 characters, as the former
+  Song::latexToUtf8 did.
+*/
+QString latexToUtf8(const QString &str);
+
+/*!
+  Returns the contents of the song \a song, as the former
+  Song::toString did.
+*/
+QString toString(const Song &song);
+
+/*!
+  Converts some utf8 characters to LaTeX sequences, as the former
+  Song::utf8ToLatex did.
+*/
+QString utf8ToLatex(const QString &str);
+}
+
+#endif // __REFERENCE_SONG_HH__
@@ -0,0 +1,219 @@
+// Copyright (C) 2009-2011, Romain Goffe <romain.goffe@gmail.com>
+// Copyright (C) 2009-2011, Alexandre Dupas <alexandre.dupas@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301, USA.
+//******************************************************************************
+#include "song.hh"
+#include "reference-song.hh"
+#include "corpus.hh"
+
+#include <QBuffer>
+#include <QDir>
+#include <QtTest>
+
+/*!
+  \class TestSong
+  \brief Checks the .sg parser and serializer against the former ones
+
+  Every file of the corpus is parsed by both Song and Reference; all
+  the fields of the resulting songs must be equal, and both must
+  write them back to the same bytes.
+*/
+class TestSong : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void corpus();
+
+    void fromString_data();
+    void fromString();
+
+    void headerOnly_data();
+    void headerOnly();
+
+    void headerFromFile_data();
+    void headerFromFile();
+
+    void toString_data();
+    void toString();
+
+    void toDevice_data();
+    void toDevice();
+
+    void roundTrip_data();
+    void roundTrip();
+
+    void escapes();
+
+private:
+    void addCorpusRows();
+};
+
+namespace
+{
+/*!
+  Compares the fields of \a song that Song::headerFromFile fills in.
+*/
+void compareHeaders(const Song &song, const Song &expected)
+{
+    QCOMPARE(song.title, expected.title);
+    QCOMPARE(song.artist, expected.artist);
+    QCOMPARE(song.album, expected.album);
+    QCOMPARE(song.originalSong, expected.originalSong);
+    QCOMPARE(song.url, expected.url);
+    QCOMPARE(song.coverName, expected.coverName);
+    QCOMPARE(song.coverPath, expected.coverPath);
+    QCOMPARE(song.path, expected.path);
+    QCOMPARE(song.locale, expected.locale);
+    QCOMPARE(song.isLilypond, expected.isLilypond);
+    QCOMPARE(song.isWebsite, expected.isWebsite);
+    QCOMPARE(song.columnCount, expected.columnCount);
+    QCOMPARE(song.capo, expected.capo);
+    QCOMPARE(song.transpose, expected.transpose);
+}
+
+/*!
+  Compares all the fields of \a song.
+*/
+void compareSongs(const Song &song, const Song &expected)
+{
+    compareHeaders(song, expected);
+    if (QTest::currentTestFailed())
+        return;
+
+    QCOMPARE(song.gtabs, expected.gtabs);
+    QCOMPARE(song.utabs, expected.utabs);
+    QCOMPARE(song.lyrics, expected.lyrics);
+    QCOMPARE(song.scripture, expected.scripture);
+}
+
+/*!
+  Returns the bytes Song::toDevice writes for \a song.
+*/
+QByteArray toDevice(const Song &song)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (!Song::toDevice(song, &buffer))
+        return QByteArray();
+    return buffer.data();
+}
+}
+
+void TestSong::addCorpusRows()
+{
+    QTest::addColumn<QString>("path");
+
+    const QDir root(corpusDirectory());
+    foreach (const QString &path, corpusFiles())
+        QTest::newRow(qPrintable(root.relativeFilePath(path))) << path;
+}
+
+void TestSong::corpus() { QVERIFY(!corpusFiles().isEmpty()); }
+
+void TestSong::fromString_data() { addCorpusRows(); }
+
+void TestSong::fromString()
+{
+    QFETCH(QString, path);
+
+    const QString text = readCorpusFile(path);
+    const Song song = Song::fromString(text, path);
+    compareSongs(song, Reference::fromString(text, path));
+}
+
+void TestSong::headerOnly_data() { addCorpusRows(); }
+
+void TestSong::headerOnly()
+{
+    QFETCH(QString, path);
+
+    const QString text = readCorpusFile(path);
+    const Song song = Song::fromString(text, path, true);
+    compareHeaders(song, Reference::fromString(text, path));
+    if (QTest::currentTestFailed())
+        return;
+
+    QVERIFY(song.gtabs.isEmpty());
+    QVERIFY(song.utabs.isEmpty());
+    QVERIFY(song.lyrics.isEmpty());
+    QVERIFY(song.scripture.isEmpty());
+}
+
+void TestSong::headerFromFile_data() { addCorpusRows(); }
+
+void TestSong::headerFromFile()
+{
+    QFETCH(QString, path);
+
+    compareHeaders(Song::headerFromFile(path), Reference::fromFile(path));
+}
+
+void TestSong::toString_data() { addCorpusRows(); }
+
+void TestSong::toString()
+{
+    QFETCH(QString, path);
+
+    const Song song = Reference::fromFile(path);
+    QCOMPARE(Song::toString(song), Reference::toString(song));
+}
+
+void TestSong::toDevice_data() { addCorpusRows(); }
+
+void TestSong::toDevice()
+{
+    QFETCH(QString, path);
+
+    const Song song = Reference::fromFile(path);
+    QCOMPARE(::toDevice(song), Reference::toString(song).toUtf8());
+}
+
+void TestSong::roundTrip_data() { addCorpusRows(); }
+
+void TestSong::roundTrip()
+{
+    QFETCH(QString, path);
+
+    // read back what each serializer wrote with its own parser
+    const Song song = Song::fromFile(path);
+    const Song expected = Reference::fromFile(path);
+    compareSongs(Song::fromString(QString::fromUtf8(::toDevice(song)), path),
+                 Reference::fromString(Reference::toString(expected), path));
+}
+
+void TestSong::escapes()
+{
+    // LaTeX special characters, non-Latin-1 characters and
+    // characters outside of the BMP
+    Song song = Song();
+    song.locale = QLocale(QLocale::French);
+    song.capo = 3;
+    song.transpose = -1;
+    song.title = QString::fromUtf8("Rock & Roll... or.... ~ 100%");
+    song.artist = QString::fromUtf8("Caf\xc3\xa9\xc2\xa0Tacvba");
+    song.album = QString::fromUtf8("\xe6\x97\xa5\xe6\x9c\xac..");
+    song.originalSong = QString::fromUtf8("\xf0\x9f\x8e\xb8 & ~");
+    song.lyrics << QString::fromUtf8("na\xc3\xafve \xf0\x9f\x8e\xb5 50%")
+                << QString() << QString::fromUtf8("\\[C]fin");
+
+    QCOMPARE(Song::toString(song), Reference::toString(song));
+    QCOMPARE(::toDevice(song), Reference::toString(song).toUtf8());
+}
+
+QTEST_GUILESS_MAIN(TestSong)
+#include "test-song.moc"